@@ -0,0 +1,153 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <malloc.h>
+
+using namespace std;
+
+#include "succinct_mpmc_queue.hpp"
+#include "succinct_trace.hpp"
+#include "succinct_adaptive_vector.hpp"
+
+// Every allocation is counted, so that replays can report their peak
+// memory. The sizes counted are those malloc actually reserved.
+static std::atomic<size_t> allocated_bytes(0);
+static std::atomic<size_t> peak_bytes(0);
+
+void * operator new(const size_t n) {
+  void * const p = std::malloc(n);
+  if (0 == p) {
+    throw std::bad_alloc();
+  }
+  const size_t bytes = malloc_usable_size(p);
+  const size_t now = allocated_bytes.fetch_add(bytes) + bytes;
+  size_t peak = peak_bytes.load();
+  while ((now > peak) and not peak_bytes.compare_exchange_weak(peak, now)) {}
+  return p;
+}
+
+// Not inlined, or GCC sees free called on a pointer from new
+__attribute__((noinline)) void operator delete(void * const p) noexcept {
+  if (0 != p) {
+    allocated_bytes.fetch_sub(malloc_usable_size(p));
+    std::free(p);
+  }
+}
+
+void * operator new[](const size_t n) { return operator new(n); }
+void operator delete[](void * const p) noexcept { operator delete(p); }
+void operator delete(void * const p, size_t) noexcept { operator delete(p); }
+void operator delete[](void * const p, size_t) noexcept { operator delete(p); }
+
+// Items per second through an mpmc_queue with the given numbers of
+// producers and consumers, each producer pushing count items.
+double mpmc_throughput(const unsigned producers, const unsigned consumers,
+                       const unsigned count) {
+  succinct::mpmc_queue<unsigned> queue;
+  std::atomic<unsigned long> popped(0);
+  const unsigned long total = static_cast<unsigned long>(producers) * count;
+  std::thread * const threads = new std::thread[producers + consumers];
+  const auto start = chrono::steady_clock::now();
+  for(unsigned p = 0; p < producers; ++p) {
+    threads[p] = std::thread([&queue, count]() {
+      for(unsigned i = 0; i < count; ++i) {
+        queue.push(i);
+      }
+    });
+  }
+  for(unsigned c = 0; c < consumers; ++c) {
+    threads[producers + c] = std::thread([&queue, &popped, total]() {
+      unsigned x;
+      unsigned long mine = 0;
+      while (popped.load(std::memory_order_relaxed) < total) {
+        if (queue.try_pop(x)) {
+          ++mine;
+          if (0 == mine % 1024) {
+            popped.fetch_add(1024);
+            mine = 0;
+          }
+        } else {
+          popped.fetch_add(mine);
+          mine = 0;
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for(unsigned t = 0; t < producers + consumers; ++t) {
+    threads[t].join();
+  }
+  const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  delete[] threads;
+  return static_cast<double>(total) / elapsed.count();
+}
+
+// Replay a trace against a new C, printing the time, the peak memory
+// allocated beyond what was allocated before, and the number of
+// capacity changes (rebuilds or reallocations).
+template<typename C>
+void replay_one(const char * const name,
+                const succinct::vector<succinct::trace_record> & trace) {
+  const size_t before = allocated_bytes.load();
+  peak_bytes = before;
+  const auto start = chrono::steady_clock::now();
+  succinct::replay_result result;
+  {
+    C c;
+    result = succinct::replay(trace, c);
+  }
+  const chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+  cout << name << " " << elapsed.count() << " " << (peak_bytes.load() - before)
+       << " " << result.capacity_changes << " " << result.checksum << endl;
+}
+
+// A workload that oscillates around a large size, like qux() in
+// test.cpp, with reads of random items
+void record_synthetic(const char * const path, const size_t count) {
+  succinct::traced_vector<unsigned> v(path);
+  const succinct::traced_vector<unsigned> & reader = v;
+  for (size_t i = 0; i < count; ++i) {
+    v.push_back(static_cast<unsigned>(i));
+  }
+  for (size_t round = 0; round < 16; ++round) {
+    for (size_t i = 0; i < count / 2; ++i) {
+      v.pop_back();
+    }
+    for (size_t i = 0; i < count / 2; ++i) {
+      v.push_back(static_cast<unsigned>(i));
+      reader[static_cast<size_t>(rand()) % v.size()];
+    }
+  }
+}
+
+int main(int argc, char ** argv) {
+  if ((argc > 2) and (0 == strcmp(argv[1], "record"))) {
+    const size_t count = (argc > 3) ? static_cast<size_t>(atol(argv[3])) : 1000000;
+    record_synthetic(argv[2], count);
+    return 0;
+  }
+  if ((argc > 2) and (0 == strcmp(argv[1], "replay"))) {
+    const succinct::vector<succinct::trace_record> trace =
+      succinct::load_trace(argv[2]);
+    cout << "replay of " << trace.size() << " operations: "
+         << "container seconds peak_bytes capacity_changes checksum" << endl;
+    replay_one<succinct::vector<unsigned> >("succinct::vector", trace);
+    replay_one<succinct::adaptive_vector<unsigned> >("succinct::adaptive_vector", trace);
+    replay_one<std::vector<unsigned> >("std::vector", trace);
+    replay_one<std::deque<unsigned> >("std::deque", trace);
+    return 0;
+  }
+  const unsigned count = (argc > 1) ? static_cast<unsigned>(atoi(argv[1])) : 1000000;
+  cout << "mpmc_queue: producers consumers items/s" << endl;
+  for(unsigned threads = 1; threads <= 16; threads *= 2) {
+    cout << threads << " " << threads << " "
+         << mpmc_throughput(threads, threads, count / threads) << endl;
+  }
+}
@@ -0,0 +1,331 @@
+/*
+A succinct vector that adapts how it grows and shrinks to the way it
+is being used.
+
+A plain vector downsizes whenever its directory falls to a quarter
+full. A workload whose size swings up and down therefore keeps paying
+for rebuilds that undo each other. An adaptive_vector watches for
+this in two ways. The churn of each window of max(policy.window,
+size()) operations is the ratio of its pushes to its pops, or of its
+pops to its pushes, whichever is at most 1. A reversal is a rebuild
+(or a declined downsize) that goes the other way from the one before.
+
+- Holding: when a pop_back would downsize and the vector has reversed
+  before, is churning, or would undo an upsize made within the last
+  8 * size() operations, it holds its shape instead. It does this by
+  raising its reservation, which stops downsizing. Holding a shape
+  costs only the directory and some unused space in the last buffers,
+  both O(\sqrt{capacity}).
+- Releasing: once the directory and unused buffer space exceed
+  policy.max_overhead bytes per byte of items, plus policy.slack_bytes,
+  the vector rebuilds once to fit its items.
+- Growing ahead: after a release, if the vector is oscillating, the
+  next upsize rebuilds straight to the shape that was released. This
+  replaces one rebuild per doubling on the way back up.
+
+The extra buffer is still kept or freed as in vector.
+
+Only the capacity adapts, not how it is split between the directory
+and the buffers. In vector, log_capacity() alone decides the shape:
+buffers of 2^ceil(L/2) items, twice the directory's length when L is
+odd (big_buffer) and equal to it otherwise. That split is what bounds
+the unused space at O(\sqrt{n}), and it is what lets every rebuild
+merge pairs of buffers or split them in half, which spill_vector relies
+on to keep spilled buffers at their offsets in its scratch file.
+Choosing a different split per workload would trade the space bound for
+fewer directory doublings, which holding already avoids, so it is left
+alone.
+
+statistics() reports the shape, the counts of operations and rebuilds,
+and the current decisions.
+
+ */
+
+#ifndef SUCCINCT_ADAPTIVE_VECTOR_HPP
+#define SUCCINCT_ADAPTIVE_VECTOR_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+struct adaptive_policy {
+  // The smallest number of operations in a window
+  std::size_t window;
+  // Windows at least this churned count as oscillating
+  double churn_threshold;
+  // The most bytes of directory and unused buffer space the vector
+  // holds per byte of items, beyond slack_bytes
+  double max_overhead;
+  std::size_t slack_bytes;
+
+  adaptive_policy() :
+    window(1024), churn_threshold(0.25), max_overhead(1.0), slack_bytes(4096) {}
+};
+
+struct adaptive_statistics {
+  vector_statistics shape;
+  std::uint64_t pushes;
+  std::uint64_t pops;
+  // Rebuilds done, and downsizes declined by holding
+  std::uint64_t rebuilds;
+  std::uint64_t avoided_rebuilds;
+  // Upsizes that went straight to a released shape
+  std::uint64_t grown_ahead;
+  std::uint64_t reversals;
+  // The churn of the last complete window
+  double churn;
+  // Whether the vector is declining to shrink, and the capacity held
+  bool holding;
+  std::size_t held_capacity;
+  // The capacity the next upsize may grow straight to, or 0
+  std::size_t grow_ahead_capacity;
+  // The directory and unused buffer space, and the most that is held
+  std::size_t overhead_bytes;
+  std::size_t overhead_limit;
+};
+
+template<typename T>
+struct adaptive_vector : protected vector<T> {
+public:
+  typedef std::size_t size_t;
+  typedef T value_type;
+  explicit adaptive_vector(const adaptive_policy & = adaptive_policy());
+  using vector<T>::size;
+  using vector<T>::capacity;
+  using vector<T>::operator[];
+  // The underlying vector
+  const vector<T> & items() const { return *this; }
+  // As in vector. O(1) amortized, Θ(n) worst case.
+  void push_back(const T &);
+  void pop_back();
+  // As in vector. A reservation is kept apart from any shape held, and
+  // shrink_to_fit drops both.
+  void reserve(const size_t n);
+  void shrink_to_fit();
+  void resize(const size_t n);
+  // O(\sqrt{n}).
+  adaptive_statistics statistics() const;
+
+protected:
+  typedef typename vector<T>::length_t length_t;
+
+  adaptive_policy policy;
+  // The reservation made by reserve(), which this->log_reserved
+  // exceeds while holding
+  length_t user_log_reserved;
+  bool holding;
+  // The log_capacity() given up by the last release, or 0
+  length_t released_log_capacity;
+  std::uint64_t operations;
+  std::uint64_t pushes;
+  std::uint64_t pops;
+  std::uint64_t rebuilds;
+  std::uint64_t avoided_rebuilds;
+  std::uint64_t grown_ahead;
+  std::uint64_t reversals;
+  // The current window, which ends after operation window_end
+  std::uint64_t window_end;
+  std::uint64_t window_pushes;
+  std::uint64_t window_pops;
+  double churn;
+  // The last rebuild or declined downsize
+  std::uint64_t last_resize;
+  bool last_resize_grew;
+
+  bool
+  oscillating() const {
+    return (churn >= policy.churn_threshold) or (reversals > 0);
+  }
+
+  size_t
+  overhead_bytes() const {
+    const size_t buffers = this->dir_size + (this->extra_buffer ? 1 : 0);
+    return this->dir_capacity() * sizeof(T *)
+      + (buffers * this->buffer_capacity() - size()) * sizeof(T);
+  }
+
+  size_t
+  overhead_limit() const {
+    return static_cast<size_t>(policy.max_overhead * static_cast<double>(size() * sizeof(T)))
+      + policy.slack_bytes;
+  }
+
+  // Record a rebuild, or a downsize declined, in the direction given.
+  void
+  resized(const bool grew, const bool rebuilt) {
+    if ((rebuilds + avoided_rebuilds > 0) and (grew != last_resize_grew)) {
+      ++reversals;
+    }
+    (rebuilt ? rebuilds : avoided_rebuilds) += 1;
+    last_resize = operations;
+    last_resize_grew = grew;
+  }
+
+  void
+  hold(const length_t log_capacity) {
+    holding = true;
+    this->log_reserved = std::max(log_capacity, user_log_reserved) & 63;
+  }
+
+  // Stop holding, rebuilding to fit if the directory is too empty.
+  void
+  release() {
+    holding = false;
+    this->log_reserved = user_log_reserved & 63;
+    if ((this->dir_size * 4 <= this->dir_capacity())
+        and (this->log_capacity() > this->log_reserved)) {
+      released_log_capacity = this->log_capacity();
+      resized(false, true);
+    }
+    this->truncate(size());
+  }
+
+  // Count an operation, and measure the churn of each complete window.
+  void
+  observe(const bool push) {
+    ++operations;
+    (push ? window_pushes : window_pops) += 1;
+    if (operations < window_end) {
+      return;
+    }
+    const std::uint64_t most = std::max(window_pushes, window_pops);
+    churn = static_cast<double>(std::min(window_pushes, window_pops))
+      / static_cast<double>(most);
+    window_end = operations + std::max(policy.window, size());
+    window_pushes = 0;
+    window_pops = 0;
+  }
+
+}; // struct adaptive_vector
+
+template<typename T>
+adaptive_vector<T>::adaptive_vector(const adaptive_policy & p) :
+  vector<T>(),
+  policy(p),
+  user_log_reserved(0),
+  holding(false),
+  released_log_capacity(0),
+  operations(0),
+  pushes(0),
+  pops(0),
+  rebuilds(0),
+  avoided_rebuilds(0),
+  grown_ahead(0),
+  reversals(0),
+  window_end(p.window),
+  window_pushes(0),
+  window_pops(0),
+  churn(0),
+  last_resize(0),
+  last_resize_grew(false)
+{}
+
+template<typename T>
+void
+adaptive_vector<T>::push_back(const T & x) {
+  ++pushes;
+  if (this->push_back_rebuilds()) {
+    if (oscillating() and (released_log_capacity > this->log_capacity() + 1)) {
+      // One rebuild back to the released shape, which is held again
+      hold(released_log_capacity);
+      this->reshape(released_log_capacity);
+      ++grown_ahead;
+    } else if (holding) {
+      // Keep holding the larger shape.
+      hold(this->log_capacity() + 1);
+    }
+    resized(true, true);
+  }
+  if (this->log_capacity() >= released_log_capacity) {
+    released_log_capacity = 0;
+  }
+  vector<T>::push_back(x);
+  observe(true);
+}
+
+template<typename T>
+void
+adaptive_vector<T>::pop_back() {
+  assert (size() > 0);
+  ++pops;
+  if (holding and (overhead_bytes() > overhead_limit())) {
+    release();
+  }
+  if (this->pop_back_rebuilds()) {
+    const bool undoes = last_resize_grew
+      and (operations - last_resize < 8 * static_cast<std::uint64_t>(size()));
+    const bool hold_shape = (oscillating() or undoes)
+      and (overhead_bytes() <= overhead_limit());
+    if (hold_shape) {
+      hold(this->log_capacity());
+    }
+    resized(false, not hold_shape);
+  }
+  vector<T>::pop_back();
+  observe(false);
+}
+
+template<typename T>
+void
+adaptive_vector<T>::reserve(const size_t n) {
+  const length_t wanted = vector<T>::log_capacity_for(n);
+  user_log_reserved = std::max(user_log_reserved, wanted);
+  if (wanted > this->log_capacity()) {
+    resized(true, true);
+  }
+  vector<T>::reserve(n);
+  if (holding) {
+    hold(this->log_reserved);
+  }
+}
+
+template<typename T>
+void
+adaptive_vector<T>::shrink_to_fit() {
+  user_log_reserved = 0;
+  holding = false;
+  released_log_capacity = 0;
+  if ((vector<T>::log_capacity_for(size()) < this->log_capacity()) or this->extra_buffer) {
+    resized(false, true);
+  }
+  vector<T>::shrink_to_fit();
+}
+
+template<typename T>
+void
+adaptive_vector<T>::resize(const size_t n) {
+  while (size() < n) {
+    push_back(T());
+  }
+  while (size() > n) {
+    pop_back();
+  }
+}
+
+template<typename T>
+adaptive_statistics
+adaptive_vector<T>::statistics() const {
+  adaptive_statistics result;
+  result.shape = vector<T>::statistics();
+  result.pushes = pushes;
+  result.pops = pops;
+  result.rebuilds = rebuilds;
+  result.avoided_rebuilds = avoided_rebuilds;
+  result.grown_ahead = grown_ahead;
+  result.reversals = reversals;
+  result.churn = churn;
+  result.holding = holding;
+  result.held_capacity = holding ? capacity() : 0;
+  result.grow_ahead_capacity = (0 == released_log_capacity) ? 0 :
+    (static_cast<size_t>(1) << released_log_capacity) - 1;
+  result.overhead_bytes = overhead_bytes();
+  result.overhead_limit = overhead_limit();
+  return result;
+}
+
+} // namespace succinct
+#endif
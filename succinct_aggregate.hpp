@@ -0,0 +1,167 @@
+/*
+Histograms and group-by sums over succinct vectors.
+
+Work is split into contiguous ranges of items, one per thread, and
+each thread counts or sums into its own private table; the tables are
+merged at the end. When two vectors are processed in lockstep, they
+are walked a contiguous chunk at a time, where the chunk size is the
+smaller of their buffer capacities. Vectors of the same size built the
+same way have the same shape, so then the chunks are whole buffers.
+
+ */
+
+#ifndef SUCCINCT_AGGREGATE_HPP
+#define SUCCINCT_AGGREGATE_HPP
+
+#include <cassert>
+#include <unordered_map>
+
+#include "succinct_vector.hpp"
+#include "succinct_parallel.hpp"
+
+namespace succinct {
+
+// Call f(items, n) on each contiguous run of the items of v in [first,
+// last).
+template<typename T, typename Function>
+void
+for_each_chunk(const vector<T> & v, const std::size_t first,
+               const std::size_t last, Function f) {
+  const std::size_t cap = v.segment_capacity();
+  for (std::size_t i = first; i < last; ) {
+    const std::size_t offset = i & (cap - 1);
+    const std::size_t len = std::min(cap - offset, last - i);
+    f(v.segment(i / cap) + offset, len);
+    i += len;
+  }
+}
+
+// Call f(a_items, b_items, n) on each pair of contiguous runs of the
+// items of a and b in [first, last).
+template<typename A, typename B, typename Function>
+void
+for_each_chunk_pair(const vector<A> & a, const vector<B> & b,
+                    const std::size_t first, const std::size_t last,
+                    Function f) {
+  const std::size_t a_cap = a.segment_capacity();
+  const std::size_t b_cap = b.segment_capacity();
+  // Both capacities are powers of 2, so no chunk straddles a segment
+  const std::size_t chunk = std::min(a_cap, b_cap);
+  for (std::size_t i = first; i < last; ) {
+    const std::size_t len = std::min(chunk - (i & (chunk - 1)), last - i);
+    f(a.segment(i / a_cap) + (i & (a_cap - 1)),
+      b.segment(i / b_cap) + (i & (b_cap - 1)),
+      len);
+    i += len;
+  }
+}
+
+// Count the items of v in each of bins equal-width bins covering
+// [lo, hi). Items outside that range are not counted. Θ(n / threads +
+// bins * threads).
+template<typename T>
+vector<std::size_t>
+histogram(const vector<T> & v, const T & lo, const T & hi,
+          const std::size_t bins, const unsigned threads = 0) {
+  assert (lo < hi);
+  assert (bins > 0);
+  const double low = static_cast<double>(lo);
+  const double scale = static_cast<double>(bins)
+    / (static_cast<double>(hi) - low);
+  const unsigned t_count = thread_count(threads, v.size());
+  vector<std::size_t *> partial;
+  partial.resize(t_count);
+  parallel_ranges(v.size(), t_count,
+    [&](const unsigned t, const std::size_t first, const std::size_t last) {
+      std::size_t * const counts = new std::size_t[bins]();
+      for_each_chunk(v, first, last, [&](const T * const x, const std::size_t n) {
+        for (std::size_t j = 0; j < n; ++j) {
+          if (not ((lo <= x[j]) and (x[j] < hi))) {
+            continue;
+          }
+          const std::size_t bin = static_cast<std::size_t>(
+            (static_cast<double>(x[j]) - low) * scale);
+          // Rounding can put items just below hi in bin number bins
+          ++counts[std::min(bin, bins - 1)];
+        }
+      });
+      partial[t] = counts;
+    });
+  vector<std::size_t> result;
+  result.resize(bins);
+  for (unsigned t = 0; t < t_count; ++t) {
+    for (std::size_t b = 0; b < bins; ++b) {
+      result[b] += partial[t][b];
+    }
+    delete[] partial[t];
+  }
+  return result;
+}
+
+// The sum of values[i] for each key k = keys[i], in result[k]. Keys
+// must be less than key_count, and keys and values must be the same
+// size. Θ(n / threads + key_count * threads).
+template<typename K, typename V>
+vector<V>
+group_sum(const vector<K> & keys, const vector<V> & values,
+          const std::size_t key_count, const unsigned threads = 0) {
+  assert (keys.size() == values.size());
+  const unsigned t_count = thread_count(threads, keys.size());
+  vector<V *> partial;
+  partial.resize(t_count);
+  parallel_ranges(keys.size(), t_count,
+    [&](const unsigned t, const std::size_t first, const std::size_t last) {
+      V * const sums = new V[key_count]();
+      for_each_chunk_pair(keys, values, first, last,
+        [&](const K * const k, const V * const x, const std::size_t n) {
+          for (std::size_t j = 0; j < n; ++j) {
+            assert (static_cast<std::size_t>(k[j]) < key_count);
+            sums[static_cast<std::size_t>(k[j])] += x[j];
+          }
+        });
+      partial[t] = sums;
+    });
+  vector<V> result;
+  result.resize(key_count);
+  for (unsigned t = 0; t < t_count; ++t) {
+    for (std::size_t k = 0; k < key_count; ++k) {
+      result[k] += partial[t][k];
+    }
+    delete[] partial[t];
+  }
+  return result;
+}
+
+// Like group_sum, for keys that are not small integers.
+// Θ(n / threads + distinct keys * threads) expected.
+template<typename K, typename V>
+std::unordered_map<K, V>
+group_sum_hashed(const vector<K> & keys, const vector<V> & values,
+                 const unsigned threads = 0) {
+  assert (keys.size() == values.size());
+  const unsigned t_count = thread_count(threads, keys.size());
+  vector<std::unordered_map<K, V> *> partial;
+  partial.resize(t_count);
+  parallel_ranges(keys.size(), t_count,
+    [&](const unsigned t, const std::size_t first, const std::size_t last) {
+      std::unordered_map<K, V> * const sums = new std::unordered_map<K, V>();
+      for_each_chunk_pair(keys, values, first, last,
+        [&](const K * const k, const V * const x, const std::size_t n) {
+          for (std::size_t j = 0; j < n; ++j) {
+            (*sums)[k[j]] += x[j];
+          }
+        });
+      partial[t] = sums;
+    });
+  std::unordered_map<K, V> result;
+  for (unsigned t = 0; t < t_count; ++t) {
+    for (const auto & kv : *partial[t]) {
+      result[kv.first] += kv.second;
+    }
+    delete partial[t];
+  }
+  return result;
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,194 @@
+/*
+Exchanging succinct vectors of numbers with Arrow through the Arrow C
+Data Interface, without depending on Arrow.
+
+export_arrow_chunks moves a vector into shared ownership and describes
+each of its non-empty buffers as one ArrowArray, so that together they
+form the chunks of an Arrow chunked array. No items are copied. Each
+array's release callback drops a reference to the vector, and the
+last one deletes it, so the buffers stay alive for as long as Arrow
+holds any chunk.
+
+import_arrow appends the items of a primitive ArrowArray to a vector
+and releases the array. This copies: a vector deletes its buffers with
+delete[], so it cannot adopt memory allocated by Arrow.
+
+Only arrays without nulls can be imported. Mismatched formats throw
+std::runtime_error.
+
+ */
+
+#ifndef SUCCINCT_ARROW_HPP
+#define SUCCINCT_ARROW_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include "succinct_vector.hpp"
+
+// The ABI, as given by the Arrow C Data Interface specification. The
+// guard lets this coexist with Arrow's own copy.
+#ifndef ARROW_C_DATA_INTERFACE
+#define ARROW_C_DATA_INTERFACE
+
+#include <stdint.h>
+
+#define ARROW_FLAG_DICTIONARY_ORDERED 1
+#define ARROW_FLAG_NULLABLE 2
+#define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+struct ArrowSchema {
+  // Array type description
+  const char* format;
+  const char* name;
+  const char* metadata;
+  int64_t flags;
+  int64_t n_children;
+  struct ArrowSchema** children;
+  struct ArrowSchema* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowSchema*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+struct ArrowArray {
+  // Array data description
+  int64_t length;
+  int64_t null_count;
+  int64_t offset;
+  int64_t n_buffers;
+  int64_t n_children;
+  const void** buffers;
+  struct ArrowArray** children;
+  struct ArrowArray* dictionary;
+
+  // Release callback
+  void (*release)(struct ArrowArray*);
+  // Opaque producer-specific data
+  void* private_data;
+};
+
+#endif  // ARROW_C_DATA_INTERFACE
+
+namespace succinct {
+
+// The Arrow format string of each primitive type
+template<typename T> struct arrow_format;
+template<> struct arrow_format<std::int8_t> { static const char * get() { return "c"; } };
+template<> struct arrow_format<std::uint8_t> { static const char * get() { return "C"; } };
+template<> struct arrow_format<std::int16_t> { static const char * get() { return "s"; } };
+template<> struct arrow_format<std::uint16_t> { static const char * get() { return "S"; } };
+template<> struct arrow_format<std::int32_t> { static const char * get() { return "i"; } };
+template<> struct arrow_format<std::uint32_t> { static const char * get() { return "I"; } };
+template<> struct arrow_format<std::int64_t> { static const char * get() { return "l"; } };
+template<> struct arrow_format<std::uint64_t> { static const char * get() { return "L"; } };
+template<> struct arrow_format<float> { static const char * get() { return "f"; } };
+template<> struct arrow_format<double> { static const char * get() { return "g"; } };
+
+// A vector shared by the arrays exported from it
+template<typename T>
+struct arrow_owner {
+  vector<T> items;
+  std::atomic<std::size_t> references;
+
+  arrow_owner() : items(), references(0) {}
+};
+
+// The private data of one exported array
+template<typename T>
+struct arrow_chunk {
+  arrow_owner<T> * owner;
+  // No validity bitmap, then the items
+  const void * buffers[2];
+};
+
+template<typename T>
+void
+release_arrow_chunk(ArrowArray * const array) {
+  arrow_chunk<T> * const chunk = static_cast<arrow_chunk<T> *>(array->private_data);
+  if (1 == chunk->owner->references.fetch_sub(1)) {
+    delete chunk->owner;
+  }
+  delete chunk;
+  array->release = 0;
+}
+
+inline void
+release_arrow_schema(ArrowSchema * const schema) {
+  schema->release = 0;
+}
+
+// Describe the items of v as an Arrow schema and one array per
+// non-empty buffer, leaving v empty. arrays must have room for
+// v.segment_count() arrays. Returns the number written; each must be
+// released, and may be released in any order. Θ(\sqrt{n}).
+template<typename T>
+std::size_t
+export_arrow_chunks(vector<T> & v, ArrowSchema * const schema, ArrowArray * const arrays) {
+  std::memset(schema, 0, sizeof(*schema));
+  schema->format = arrow_format<T>::get();
+  schema->name = "";
+  schema->release = release_arrow_schema;
+
+  arrow_owner<T> * const owner = new arrow_owner<T>();
+  owner->items.swap(v);
+  const vector<T> & items = owner->items;
+  std::size_t count = 0;
+  for (std::size_t k = 0; k < items.segment_count(); ++k) {
+    if (0 != items.segment_size(k)) {
+      ++count;
+    }
+  }
+  if (0 == count) {
+    delete owner;
+    return 0;
+  }
+  owner->references = count;
+  std::size_t j = 0;
+  for (std::size_t k = 0; k < items.segment_count(); ++k) {
+    const std::size_t m = items.segment_size(k);
+    if (0 == m) {
+      continue;
+    }
+    arrow_chunk<T> * const chunk = new arrow_chunk<T>();
+    chunk->owner = owner;
+    chunk->buffers[0] = 0;
+    chunk->buffers[1] = items.segment(k);
+    ArrowArray & array = arrays[j++];
+    std::memset(&array, 0, sizeof(array));
+    array.length = static_cast<std::int64_t>(m);
+    array.n_buffers = 2;
+    array.buffers = chunk->buffers;
+    array.release = release_arrow_chunk<T>;
+    array.private_data = chunk;
+  }
+  assert (j == count);
+  return count;
+}
+
+// Append the items of array, described by schema, to v, then release
+// array. Θ(length of the array).
+template<typename T>
+void
+import_arrow(vector<T> & v, ArrowArray * const array, const ArrowSchema * const schema) {
+  if ((0 != std::strcmp(schema->format, arrow_format<T>::get()))
+      or (2 != array->n_buffers)) {
+    array->release(array);
+    throw std::runtime_error("succinct: Arrow array has the wrong type");
+  }
+  if ((0 != array->null_count) and (0 != array->buffers[0])) {
+    array->release(array);
+    throw std::runtime_error("succinct: Arrow array has nulls");
+  }
+  const T * const items = static_cast<const T *>(array->buffers[1]) + array->offset;
+  v.append(items, items + array->length);
+  array->release(array);
+}
+
+} // namespace succinct
+#endif
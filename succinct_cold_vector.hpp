@@ -0,0 +1,379 @@
+/*
+A succinct vector whose cold buffers are kept compressed.
+
+Calling compress_cold() compresses, with the codec in succinct_lz.hpp,
+every full buffer that has not been accessed since the previous call.
+A compressed buffer is tagged in the directory by setting the low bit
+of its pointer, which is otherwise always clear since buffers and
+compressed blobs are allocated by new.
+
+Reading an item in a compressed buffer decompresses the buffer into a
+small LRU cache; the compressed copy stays in the directory. Writing
+an item in a compressed buffer decompresses it for good. Before any
+rebuild, all buffers are decompressed, since rebuilds move items
+between buffers.
+
+Items must be trivially copyable, since buffers are compressed as
+bytes.
+
+ */
+
+#ifndef SUCCINCT_COLD_VECTOR_HPP
+#define SUCCINCT_COLD_VECTOR_HPP
+
+#include <cstdint>
+#include <cassert>
+#include <type_traits>
+
+#include "succinct_vector.hpp"
+#include "succinct_lz.hpp"
+
+namespace succinct {
+
+template<typename T>
+struct cold_vector : protected vector<T> {
+public:
+  typedef std::size_t size_t;
+  // cache_capacity is the number of decompressed buffers kept for
+  // reads
+  explicit cold_vector(const size_t cache_capacity = 4);
+  cold_vector(const cold_vector &) = delete;
+  cold_vector & operator=(const cold_vector &) = delete;
+  ~cold_vector();
+  using vector<T>::size;
+  using vector<T>::capacity;
+  // Reads may decompress a buffer into the cache, evicting another
+  // one. The reference is only valid until the next access. O(1) if
+  // the buffer is not compressed, otherwise Θ(\sqrt{n}) on a cache
+  // miss.
+  const T & operator[](const size_t) const;
+  // Writes decompress the buffer for good.
+  T & operator[](const size_t);
+  // Add an item to the end of the vector. O(1) amortized, Θ(n) worst
+  // case.
+  void push_back(const T &);
+  // Delete an item from the end of the vector. The vector must be
+  // non-empty. O(1) amortized, Θ(n) worst case.
+  void pop_back();
+  // Compress every full buffer not accessed since the last call.
+  // Returns the number of buffers compressed. Θ(n).
+  size_t compress_cold();
+  // The number of buffers that are compressed
+  size_t compressed_buffers() const;
+  // The number of bytes used by compressed buffers
+  size_t compressed_bytes() const;
+  size_t cache_hits() const;
+  size_t cache_misses() const;
+
+protected:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "cold_vector compresses items as bytes");
+  typedef typename vector<T>::length_t length_t;
+
+  struct blob {
+    size_t byte_count;
+    unsigned char * bytes;
+  };
+
+  struct cache_entry {
+    // The directory index of the buffer, or the directory capacity if
+    // the entry is empty.
+    length_t index;
+    // When this entry was last used, for LRU eviction
+    std::uint64_t last_used;
+    T * buffer;
+  };
+
+  // Whether each buffer has been accessed since compress_cold()
+  mutable vector<unsigned char> touched;
+  mutable cache_entry * cache;
+  size_t cache_size;
+  mutable std::uint64_t clock;
+  mutable size_t hits;
+  mutable size_t misses;
+
+  static bool
+  is_compressed(const T * const p) {
+    return 1 == (reinterpret_cast<std::uintptr_t>(p) & 1);
+  }
+
+  static blob *
+  untag(T * const p) {
+    assert (is_compressed(p));
+    return reinterpret_cast<blob *>(reinterpret_cast<std::uintptr_t>(p) - 1);
+  }
+
+  static T *
+  tag(blob * const b) {
+    assert (0 == (reinterpret_cast<std::uintptr_t>(b) & 1));
+    return reinterpret_cast<T *>(reinterpret_cast<std::uintptr_t>(b) | 1);
+  }
+
+  size_t
+  buffer_bytes() const {
+    return sizeof(T) * this->buffer_capacity();
+  }
+
+  T *
+  decompress(const blob * const b) const {
+    T * const result = new T[this->buffer_capacity()];
+    lz_decompress(b->bytes, reinterpret_cast<unsigned char *>(result),
+                  buffer_bytes());
+    return result;
+  }
+
+  // The decompressed copy of compressed buffer k, from the cache if
+  // possible
+  T *
+  cached(const length_t k) const {
+    ++clock;
+    cache_entry * victim = cache;
+    for (size_t j = 0; j < cache_size; ++j) {
+      if (k == cache[j].index) {
+        ++hits;
+        cache[j].last_used = clock;
+        return cache[j].buffer;
+      }
+      if (cache[j].last_used < victim->last_used) {
+        victim = &cache[j];
+      }
+    }
+    ++misses;
+    delete[] victim->buffer;
+    victim->index = k;
+    victim->last_used = clock;
+    victim->buffer = decompress(untag(this->dir[k]));
+    return victim->buffer;
+  }
+
+  void
+  clear_cache() {
+    for (size_t j = 0; j < cache_size; ++j) {
+      delete[] cache[j].buffer;
+      cache[j].index = this->dir_capacity();
+      cache[j].last_used = 0;
+      cache[j].buffer = 0;
+    }
+  }
+
+  // Decompress buffer k for good
+  void
+  thaw(const length_t k) {
+    T * & entry = this->dir[k];
+    if (not is_compressed(entry)) {
+      return;
+    }
+    blob * const b = untag(entry);
+    T * result = 0;
+    for (size_t j = 0; j < cache_size; ++j) {
+      if (k == cache[j].index) {
+        // Take the buffer out of the cache
+        result = cache[j].buffer;
+        cache[j].index = this->dir_capacity();
+        cache[j].last_used = 0;
+        cache[j].buffer = 0;
+      }
+    }
+    if (0 == result) {
+      result = decompress(b);
+    }
+    entry = result;
+    delete[] b->bytes;
+    delete b;
+  }
+
+  void
+  thaw_all() {
+    for (length_t k = 0; k < this->dir_size; ++k) {
+      thaw(k);
+    }
+    clear_cache();
+  }
+
+  // After a rebuild, buffer indexes have changed. Consider everything
+  // recently accessed.
+  void
+  rebuilt() {
+    clear_cache();
+    touched.resize(0);
+    touched.resize(this->dir_capacity());
+    mark_all_touched();
+  }
+
+  void
+  mark_all_touched() {
+    for (size_t k = 0; k < touched.size(); ++k) {
+      touched[k] = 1;
+    }
+  }
+
+}; // struct cold_vector
+
+template<typename T>
+cold_vector<T>::cold_vector(const size_t cache_capacity) :
+  vector<T>(),
+  touched(),
+  cache(new cache_entry[cache_capacity]),
+  cache_size(cache_capacity),
+  clock(0),
+  hits(0),
+  misses(0)
+{
+  assert (cache_size > 0);
+  for (size_t j = 0; j < cache_size; ++j) {
+    cache[j].buffer = 0;
+  }
+  rebuilt();
+}
+
+template<typename T>
+cold_vector<T>::~cold_vector() {
+  // The vector destructor cannot deallocate compressed buffers
+  for (length_t k = 0; k < this->dir_size; ++k) {
+    if (is_compressed(this->dir[k])) {
+      blob * const b = untag(this->dir[k]);
+      delete[] b->bytes;
+      delete b;
+      this->dir[k] = 0;
+    }
+  }
+  clear_cache();
+  delete[] cache;
+}
+
+template<typename T>
+const T &
+cold_vector<T>::operator[](const size_t i) const {
+  assert (i < size());
+  const length_t big = static_cast<length_t>(i >> this->log_buffer_capacity);
+  const size_t little = i & (this->buffer_capacity() - 1);
+  touched[big] = 1;
+  const T * const buffer = this->dir[big];
+  if (is_compressed(buffer)) {
+    return cached(big)[little];
+  }
+  return buffer[little];
+}
+
+template<typename T>
+T &
+cold_vector<T>::operator[](const size_t i) {
+  assert (i < size());
+  const length_t big = static_cast<length_t>(i >> this->log_buffer_capacity);
+  touched[big] = 1;
+  thaw(big);
+  return this->pget(i);
+}
+
+template<typename T>
+void
+cold_vector<T>::push_back(const T & x) {
+  const bool rebuilds = this->push_back_rebuilds();
+  if (rebuilds) {
+    thaw_all();
+  }
+#ifndef NDEBUG
+  const length_t old_log_capacity = this->log_capacity();
+#endif
+  vector<T>::push_back(x);
+  assert (rebuilds or (old_log_capacity == this->log_capacity()));
+  if (rebuilds) {
+    rebuilt();
+  }
+}
+
+template<typename T>
+void
+cold_vector<T>::pop_back() {
+  assert (size() > 0);
+  const bool rebuilds = this->pop_back_rebuilds();
+  if (rebuilds) {
+    thaw_all();
+  } else if (0 == this->last_buffer_size) {
+    // The buffer before the last one is about to become the last
+    // one, which is written to in place.
+    thaw(this->dir_size - 2);
+  }
+#ifndef NDEBUG
+  const length_t old_log_capacity = this->log_capacity();
+#endif
+  vector<T>::pop_back();
+  assert (rebuilds or (old_log_capacity == this->log_capacity()));
+  if (rebuilds) {
+    rebuilt();
+  }
+}
+
+template<typename T>
+size_t
+cold_vector<T>::compress_cold() {
+  size_t result = 0;
+  unsigned char * const scratch =
+    new unsigned char[lz_compress_bound(buffer_bytes())];
+  // The last buffer is never compressed, since it is still being
+  // filled.
+  for (length_t k = 0; k + 1 < this->dir_size; ++k) {
+    T * & entry = this->dir[k];
+    if (touched[k] or is_compressed(entry)) {
+      continue;
+    }
+    const size_t byte_count =
+      lz_compress(reinterpret_cast<const unsigned char *>(entry),
+                  buffer_bytes(), scratch);
+    if (byte_count >= buffer_bytes()) {
+      // Incompressible
+      continue;
+    }
+    blob * const b = new blob;
+    b->byte_count = byte_count;
+    b->bytes = new unsigned char[byte_count];
+    std::copy(scratch, scratch + byte_count, b->bytes);
+    delete[] entry;
+    entry = tag(b);
+    ++result;
+  }
+  delete[] scratch;
+  for (size_t k = 0; k < touched.size(); ++k) {
+    touched[k] = 0;
+  }
+  return result;
+}
+
+template<typename T>
+size_t
+cold_vector<T>::compressed_buffers() const {
+  size_t result = 0;
+  for (length_t k = 0; k < this->dir_size; ++k) {
+    if (is_compressed(this->dir[k])) {
+      ++result;
+    }
+  }
+  return result;
+}
+
+template<typename T>
+size_t
+cold_vector<T>::compressed_bytes() const {
+  size_t result = 0;
+  for (length_t k = 0; k < this->dir_size; ++k) {
+    if (is_compressed(this->dir[k])) {
+      result += sizeof(blob) + untag(this->dir[k])->byte_count;
+    }
+  }
+  return result;
+}
+
+template<typename T>
+size_t
+cold_vector<T>::cache_hits() const {
+  return hits;
+}
+
+template<typename T>
+size_t
+cold_vector<T>::cache_misses() const {
+  return misses;
+}
+
+} // namespace succinct
+#endif
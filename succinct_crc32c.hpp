@@ -0,0 +1,83 @@
+/*
+CRC32C (the Castagnoli polynomial, as used by iSCSI and ext4) of a
+range of bytes.
+
+On x86-64 with SSE4.2, which is checked at run time, this uses the
+crc32 instruction 8 bytes at a time. Otherwise it uses a table a byte
+at a time.
+
+ */
+
+#ifndef SUCCINCT_CRC32C_HPP
+#define SUCCINCT_CRC32C_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#endif
+
+namespace succinct {
+
+inline const std::uint32_t *
+crc32c_table() {
+  struct table {
+    std::uint32_t entries[256];
+    table() {
+      for (std::uint32_t i = 0; i < 256; ++i) {
+        std::uint32_t crc = i;
+        for (int j = 0; j < 8; ++j) {
+          crc = (crc >> 1) ^ ((crc & 1) ? 0x82f63b78u : 0);
+        }
+        entries[i] = crc;
+      }
+    }
+  };
+  static const table result;
+  return result.entries;
+}
+
+inline std::uint32_t
+crc32c_portable(std::uint32_t crc, const unsigned char * p, std::size_t n) {
+  const std::uint32_t * const table = crc32c_table();
+  for (; n > 0; --n, ++p) {
+    crc = table[(crc ^ *p) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target("sse4.2")))
+inline std::uint32_t
+crc32c_hardware(std::uint32_t crc, const unsigned char * p, std::size_t n) {
+  std::uint64_t wide = crc;
+  for (; n >= 8; n -= 8, p += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    wide = _mm_crc32_u64(wide, word);
+  }
+  crc = static_cast<std::uint32_t>(wide);
+  for (; n > 0; --n, ++p) {
+    crc = _mm_crc32_u8(crc, *p);
+  }
+  return crc;
+}
+#endif
+
+// The CRC32C of the n bytes at data, continuing from the CRC32C crc of
+// the bytes before them (0 if there are none).
+inline std::uint32_t
+crc32c(const std::uint32_t crc, const void * const data, const std::size_t n) {
+  const unsigned char * const p = static_cast<const unsigned char *>(data);
+#if defined(__x86_64__) && defined(__GNUC__)
+  static const bool hardware = __builtin_cpu_supports("sse4.2");
+  if (hardware) {
+    return ~crc32c_hardware(~crc, p, n);
+  }
+#endif
+  return ~crc32c_portable(~crc, p, n);
+}
+
+} // namespace succinct
+#endif
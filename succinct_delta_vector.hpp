@@ -0,0 +1,345 @@
+/*
+A compressed vector of integers, for series in which neighboring items
+are close in value.
+
+Items are grouped into blocks of 2^12. Every block but the last is
+frozen: each item is stored as the difference from the one before it,
+zigzag-encoded so small negative differences are small, and then
+written as a little-endian base-128 varint. The items after the
+frozen blocks are kept uncompressed in a tail of up to two blocks, so
+push_back and pop_back are cheap. The tail is frozen down to one block
+only when a push finds it holding two, and the last frozen block is
+thawed only when a pop finds the tail empty, so at least 2^12 pushes or
+pops separate any two freezes or thaws, even when the size goes back
+and forth across a block boundary.
+
+To index into a frozen block, every 64th item is stored as the
+difference from the first item of the block, and its byte offset is
+kept in a sample index. operator[] decodes at most 64 varints.
+
+The block directory is a succinct::vector, so the space used beyond the
+compressed bytes is O(n / 2^12) sample indexes plus the uncompressed
+tail.
+
+ */
+
+#ifndef SUCCINCT_DELTA_VECTOR_HPP
+#define SUCCINCT_DELTA_VECTOR_HPP
+
+#include <cstdint>
+#include <cassert>
+#include <type_traits>
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+template<typename T>
+struct delta_vector {
+public:
+  typedef std::size_t size_t;
+  delta_vector();
+  delta_vector(const delta_vector &);
+  delta_vector & operator=(const delta_vector &);
+  ~delta_vector();
+  size_t size() const;
+  // O(1): decodes at most 64 items.
+  T operator[](const size_t) const;
+  // Add an item to the end of the vector. O(1) amortized, Θ(2^12)
+  // worst case, when the first block of a full tail is frozen.
+  void push_back(const T &);
+  // Delete an item from the end of the vector. The vector must be
+  // non-empty. O(1) amortized, Θ(2^12) worst case, when the last
+  // frozen block is thawed.
+  void pop_back();
+  // Call f on each item in order. This decodes sequentially, without
+  // using the sample index.
+  template<typename Function>
+  void for_each(Function f) const;
+  // The number of bytes used by the frozen blocks, including their
+  // sample indexes.
+  size_t compressed_bytes() const;
+  // The number of times a block was frozen or thawed
+  size_t freezes() const;
+  size_t thaws() const;
+
+protected:
+  static_assert(std::is_integral<T>::value,
+                "delta_vector holds integers");
+  typedef typename std::make_unsigned<T>::type unsigned_t;
+  typedef std::uint16_t offset_t;
+
+  static const unsigned log_block_size = 12;
+  static const unsigned log_sample_rate = 6;
+  static const size_t block_size = static_cast<size_t>(1) << log_block_size;
+  static const size_t sample_rate = static_cast<size_t>(1) << log_sample_rate;
+
+  struct block {
+    // The first item in the block
+    T base;
+    // The byte offset of every sample_rate'th item
+    offset_t samples[block_size / sample_rate];
+    std::uint32_t byte_count;
+    unsigned char * bytes;
+  };
+
+  // A varint takes at most 10 bytes, so the offsets within a block
+  // fit in 16 bits.
+  static_assert(block_size * ((sizeof(T) * 8 + 6) / 7) <= 65536,
+                "offsets fit in offset_t");
+
+  vector<block> blocks;
+  // The uncompressed items after the frozen blocks. This has room
+  // for two blocks.
+  T * tail;
+  size_t tail_size;
+  size_t freeze_count;
+  size_t thaw_count;
+
+  static unsigned_t
+  zigzag(const unsigned_t delta) {
+    return static_cast<unsigned_t>(
+      static_cast<unsigned_t>(delta << 1)
+      ^ static_cast<unsigned_t>(0 - (delta >> (sizeof(T) * 8 - 1))));
+  }
+
+  static unsigned_t
+  unzigzag(const unsigned_t z) {
+    return static_cast<unsigned_t>(
+      (z >> 1) ^ static_cast<unsigned_t>(0 - (z & 1)));
+  }
+
+  // Decode one varint starting at p, returning the byte past it.
+  static const unsigned char *
+  decode(const unsigned char * p, unsigned_t & result) {
+    result = 0;
+    unsigned shift = 0;
+    while (*p & 0x80) {
+      result = static_cast<unsigned_t>(
+        result | (static_cast<unsigned_t>(*p & 0x7f) << shift));
+      shift += 7;
+      ++p;
+    }
+    result = static_cast<unsigned_t>(
+      result | (static_cast<unsigned_t>(*p) << shift));
+    return p + 1;
+  }
+
+  // The item after prev, given its encoded difference from prev
+  static T
+  step(const T prev, const unsigned_t z) {
+    return static_cast<T>(static_cast<unsigned_t>(prev) + unzigzag(z));
+  }
+
+  // Compress the first block of the tail, which must be full, into a
+  // new frozen block, and move the second block of the tail down.
+  void
+  freeze() {
+    assert (2 * block_size == tail_size);
+    // Encode into a worst-case-sized scratch buffer first so that the
+    // frozen bytes can be allocated at their exact size.
+    const size_t max_varint = (sizeof(T) * 8 + 6) / 7;
+    unsigned char * const scratch = new unsigned char[block_size * max_varint];
+    block b;
+    b.base = tail[0];
+    unsigned char * p = scratch;
+    for (size_t k = 0; k < block_size; ++k) {
+      const bool sampled = (0 == (k & (sample_rate - 1)));
+      if (sampled) {
+        b.samples[k >> log_sample_rate] = static_cast<offset_t>(p - scratch);
+      }
+      const T prev = sampled ? b.base : tail[k-1];
+      unsigned_t z = zigzag(static_cast<unsigned_t>(
+        static_cast<unsigned_t>(tail[k]) - static_cast<unsigned_t>(prev)));
+      while (z >= 0x80) {
+        *p++ = static_cast<unsigned char>((z & 0x7f) | 0x80);
+        z = static_cast<unsigned_t>(z >> 7);
+      }
+      *p++ = static_cast<unsigned char>(z);
+    }
+    b.byte_count = static_cast<std::uint32_t>(p - scratch);
+    b.bytes = new unsigned char[b.byte_count];
+    std::copy(scratch, p, b.bytes);
+    delete[] scratch;
+    blocks.push_back(b);
+    std::copy(tail + block_size, tail + 2 * block_size, tail);
+    tail_size = block_size;
+    ++freeze_count;
+  }
+
+  // Decompress the last frozen block back into the tail, which must
+  // be empty.
+  void
+  thaw() {
+    assert (0 == tail_size);
+    assert (blocks.size() > 0);
+    const block & b = blocks[blocks.size() - 1];
+    decode_block(b, tail);
+    delete[] b.bytes;
+    blocks.pop_back();
+    tail_size = block_size;
+    ++thaw_count;
+  }
+
+  static void
+  decode_block(const block & b, T * out) {
+    const unsigned char * p = b.bytes;
+    for (size_t k = 0; k < block_size; ++k) {
+      unsigned_t z;
+      p = decode(p, z);
+      out[k] = step((0 == (k & (sample_rate - 1))) ? b.base : out[k-1], z);
+    }
+  }
+
+  void
+  copy_from(const delta_vector & that) {
+    for (size_t i = 0; i < that.blocks.size(); ++i) {
+      block b = that.blocks[i];
+      b.bytes = new unsigned char[b.byte_count];
+      std::copy(that.blocks[i].bytes,
+                that.blocks[i].bytes + b.byte_count,
+                b.bytes);
+      blocks.push_back(b);
+    }
+    std::copy(that.tail, that.tail + that.tail_size, tail);
+    tail_size = that.tail_size;
+  }
+
+  void
+  destruct() {
+    for (size_t i = 0; i < blocks.size(); ++i) {
+      delete[] blocks[i].bytes;
+    }
+    delete[] tail;
+  }
+
+}; // struct delta_vector
+
+template<typename T>
+delta_vector<T>::delta_vector() :
+  blocks(),
+  tail(new T[2 * block_size]),
+  tail_size(0),
+  freeze_count(0),
+  thaw_count(0)
+{}
+
+template<typename T>
+delta_vector<T>::delta_vector(const delta_vector<T> & that) :
+  blocks(),
+  tail(new T[2 * block_size]),
+  tail_size(0),
+  freeze_count(0),
+  thaw_count(0)
+{
+  copy_from(that);
+}
+
+template<typename T>
+delta_vector<T> &
+delta_vector<T>::operator=(const delta_vector<T> & that) {
+  if (this == &that) {
+    return *this;
+  }
+  destruct();
+  blocks = vector<block>();
+  tail = new T[2 * block_size];
+  copy_from(that);
+  return *this;
+}
+
+template<typename T>
+delta_vector<T>::~delta_vector() {
+  destruct();
+}
+
+template<typename T>
+size_t
+delta_vector<T>::size() const {
+  return (blocks.size() << log_block_size) + tail_size;
+}
+
+template<typename T>
+T
+delta_vector<T>::operator[](const size_t i) const {
+  assert (i < size());
+  const size_t big = i >> log_block_size;
+  const size_t little = i & (block_size - 1);
+  if (big >= blocks.size()) {
+    return tail[i - (blocks.size() << log_block_size)];
+  }
+  const block & b = blocks[big];
+  const unsigned char * p = b.bytes + b.samples[little >> log_sample_rate];
+  T result = b.base;
+  for (size_t k = 0; k <= (little & (sample_rate - 1)); ++k) {
+    unsigned_t z;
+    p = decode(p, z);
+    result = step(result, z);
+  }
+  return result;
+}
+
+template<typename T>
+void
+delta_vector<T>::push_back(const T & x) {
+  if (2 * block_size == tail_size) {
+    freeze();
+  }
+  tail[tail_size] = x;
+  ++tail_size;
+}
+
+template<typename T>
+void
+delta_vector<T>::pop_back() {
+  assert (size() > 0);
+  if (0 == tail_size) {
+    thaw();
+  }
+  --tail_size;
+}
+
+template<typename T>
+template<typename Function>
+void
+delta_vector<T>::for_each(Function f) const {
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    const block & b = blocks[i];
+    const unsigned char * p = b.bytes;
+    T prev = b.base;
+    for (size_t k = 0; k < block_size; ++k) {
+      unsigned_t z;
+      p = decode(p, z);
+      prev = step((0 == (k & (sample_rate - 1))) ? b.base : prev, z);
+      f(prev);
+    }
+  }
+  for (size_t k = 0; k < tail_size; ++k) {
+    f(tail[k]);
+  }
+}
+
+template<typename T>
+size_t
+delta_vector<T>::compressed_bytes() const {
+  size_t result = 0;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    result += sizeof(block) + blocks[i].byte_count;
+  }
+  return result;
+}
+
+template<typename T>
+size_t
+delta_vector<T>::freezes() const {
+  return freeze_count;
+}
+
+template<typename T>
+size_t
+delta_vector<T>::thaws() const {
+  return thaw_count;
+}
+
+} // namespace succinct
+#endif
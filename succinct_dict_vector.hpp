@@ -0,0 +1,306 @@
+/*
+A dictionary-encoded succinct vector, for items with few distinct
+values.
+
+Each distinct value is given a code, in order of first appearance.
+The codes are bit-packed into a succinct::vector of 64-bit words, so
+with k distinct values and n items this uses about n lg k bits for the
+codes, plus the dictionary. Codes are 1, 2, 4, 8, 16 or 32 bits wide,
+so that no code straddles a word. When a new value needs a wider
+code, the words are re-packed in place from the back.
+
+Predicates are evaluated once per distinct value. Items are then
+matched against the packed codes a word at a time (SIMD within a
+register), so counting the items equal to one value costs O(n lg k / 64)
+word operations.
+
+ */
+
+#ifndef SUCCINCT_DICT_VECTOR_HPP
+#define SUCCINCT_DICT_VECTOR_HPP
+
+#include <cstdint>
+#include <cassert>
+#include <functional>
+#include <unordered_map>
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+template<typename T, typename Hash = std::hash<T> >
+struct dict_vector {
+public:
+  typedef std::size_t size_t;
+  typedef std::uint32_t code_t;
+  dict_vector();
+  size_t size() const;
+  // O(1)
+  const T & operator[](const size_t) const;
+  // Replace the ith item. O(1) amortized, Θ(n) worst case, when the
+  // codes must be widened.
+  void set(const size_t, const T &);
+  // Add an item to the end of the vector. O(1) amortized, Θ(n) worst
+  // case.
+  void push_back(const T &);
+  // Delete an item from the end of the vector. The value stays in the
+  // dictionary. O(1) amortized, Θ(n) worst case.
+  void pop_back();
+  // The code of the ith item, which indexes dictionary().
+  code_t code(const size_t) const;
+  // The number of bits in each code
+  unsigned code_width() const;
+  // The distinct values, indexed by code
+  const vector<T> & dictionary() const;
+  // The number of items equal to x. O(n lg k / 64).
+  size_t count(const T & x) const;
+  // The number of items for which pred is true. pred is called once
+  // per distinct value. If it is true for m values, this is
+  // O(m n lg k / 64 + k) when m lg k <= 64, otherwise O(n + k).
+  template<typename Predicate>
+  size_t count_if(Predicate pred) const;
+
+protected:
+  typedef std::uint64_t word_t;
+
+  // The codes, packed little-end first into words
+  vector<word_t> words;
+  size_t item_count;
+  // The log_2 of the code width, 0 through 5
+  unsigned log_code_width;
+  vector<T> values;
+  std::unordered_map<T, code_t, Hash> codes;
+
+  unsigned
+  log_codes_per_word() const {
+    return 6 - log_code_width;
+  }
+
+  word_t
+  code_mask() const {
+    return (static_cast<word_t>(1) << (1u << log_code_width)) - 1;
+  }
+
+  // A word with every code equal to c
+  word_t
+  broadcast(const code_t c) const {
+    return (~static_cast<word_t>(0) / code_mask()) * c;
+  }
+
+  static unsigned
+  popcount(const word_t x) {
+    return static_cast<unsigned>(__builtin_popcountll(x));
+  }
+
+  // The mask of the codes in word j that belong to items
+  word_t
+  live_mask(const size_t j) const {
+    const size_t end = item_count - (j << log_codes_per_word());
+    if (end >= (static_cast<size_t>(1) << log_codes_per_word())) {
+      return ~static_cast<word_t>(0);
+    }
+    return (static_cast<word_t>(1) << (end << log_code_width)) - 1;
+  }
+
+  // Find the code of x, adding it to the dictionary (and widening the
+  // codes) if necessary.
+  code_t
+  intern(const T & x) {
+    const auto found = codes.find(x);
+    if (codes.end() != found) {
+      return found->second;
+    }
+    const code_t result = static_cast<code_t>(values.size());
+    if ((result > code_mask()) and (log_code_width < 5)) {
+      widen();
+    }
+    // There are at most 2^32 distinct values:
+    assert (result <= code_mask());
+    values.push_back(x);
+    codes.insert(std::make_pair(x, result));
+    return result;
+  }
+
+  void
+  put(const size_t i, const code_t c) {
+    assert (c <= code_mask());
+    const size_t j = i >> log_codes_per_word();
+    const unsigned shift = static_cast<unsigned>(
+      (i & ((static_cast<size_t>(1) << log_codes_per_word()) - 1))
+      << log_code_width);
+    word_t & w = words[j];
+    w = (w & ~(code_mask() << shift)) | (static_cast<word_t>(c) << shift);
+  }
+
+  // The number of items with code c. A code is zero iff its high bit
+  // is clear after adding its low bits to themselves and or-ing in
+  // the original; this carries any set bit into the high bit without
+  // crossing into the next code.
+  size_t
+  count_code(const code_t c) const {
+    const word_t pattern = broadcast(c);
+    const word_t high = broadcast(static_cast<code_t>(1) << (code_width() - 1));
+    const word_t low = ~high;
+    size_t result = 0;
+    for (size_t j = 0; j < words.size(); ++j) {
+      const word_t x = words[j] ^ pattern;
+      const word_t nonzero = (((x & low) + low) | x) & high;
+      result += popcount(~nonzero & high & live_mask(j));
+    }
+    return result;
+  }
+
+  // Double the code width. Word j of the result holds half of the
+  // codes of word j/2 before, so going backwards each word is read
+  // before it is overwritten. This needs no space beyond the new
+  // words.
+  void
+  widen() {
+    assert (log_code_width < 5);
+    const unsigned old_width = 1u << log_code_width;
+    const word_t old_mask = code_mask();
+    ++log_code_width;
+    const size_t new_word_count =
+      (item_count + (static_cast<size_t>(1) << log_codes_per_word()) - 1)
+      >> log_codes_per_word();
+    while (words.size() < new_word_count) {
+      words.push_back(0);
+    }
+    const unsigned half = 1u << (log_codes_per_word());
+    for (size_t k = new_word_count; k > 0; --k) {
+      const size_t j = k - 1;
+      const word_t old = words[j/2] >> ((j & 1) * 32);
+      word_t result = 0;
+      for (unsigned t = 0; t < half; ++t) {
+        result |= ((old >> (t * old_width)) & old_mask) << (t * 2 * old_width);
+      }
+      words[j] = result;
+    }
+  }
+
+}; // struct dict_vector
+
+template<typename T, typename Hash>
+dict_vector<T, Hash>::dict_vector() :
+  words(),
+  item_count(0),
+  log_code_width(0),
+  values(),
+  codes()
+{}
+
+template<typename T, typename Hash>
+size_t
+dict_vector<T, Hash>::size() const {
+  return item_count;
+}
+
+template<typename T, typename Hash>
+typename dict_vector<T, Hash>::code_t
+dict_vector<T, Hash>::code(const size_t i) const {
+  assert (i < item_count);
+  const size_t j = i >> log_codes_per_word();
+  const unsigned shift = static_cast<unsigned>(
+    (i & ((static_cast<size_t>(1) << log_codes_per_word()) - 1))
+    << log_code_width);
+  return static_cast<code_t>((words[j] >> shift) & code_mask());
+}
+
+template<typename T, typename Hash>
+const T &
+dict_vector<T, Hash>::operator[](const size_t i) const {
+  return values[code(i)];
+}
+
+template<typename T, typename Hash>
+void
+dict_vector<T, Hash>::set(const size_t i, const T & x) {
+  assert (i < item_count);
+  put(i, intern(x));
+}
+
+template<typename T, typename Hash>
+void
+dict_vector<T, Hash>::push_back(const T & x) {
+  const code_t c = intern(x);
+  if (0 == (item_count & ((static_cast<size_t>(1) << log_codes_per_word()) - 1))) {
+    words.push_back(0);
+  }
+  ++item_count;
+  put(item_count - 1, c);
+}
+
+template<typename T, typename Hash>
+void
+dict_vector<T, Hash>::pop_back() {
+  assert (item_count > 0);
+  // Unused codes are kept at 0
+  put(item_count - 1, 0);
+  --item_count;
+  if (0 == (item_count & ((static_cast<size_t>(1) << log_codes_per_word()) - 1))) {
+    words.pop_back();
+  }
+}
+
+template<typename T, typename Hash>
+unsigned
+dict_vector<T, Hash>::code_width() const {
+  return 1u << log_code_width;
+}
+
+template<typename T, typename Hash>
+const vector<T> &
+dict_vector<T, Hash>::dictionary() const {
+  return values;
+}
+
+template<typename T, typename Hash>
+size_t
+dict_vector<T, Hash>::count(const T & x) const {
+  const auto found = codes.find(x);
+  if (codes.end() == found) {
+    return 0;
+  }
+  return count_code(found->second);
+}
+
+template<typename T, typename Hash>
+template<typename Predicate>
+size_t
+dict_vector<T, Hash>::count_if(Predicate pred) const {
+  vector<code_t> matches;
+  for (size_t c = 0; c < values.size(); ++c) {
+    if (pred(values[c])) {
+      matches.push_back(static_cast<code_t>(c));
+    }
+  }
+  size_t result = 0;
+  if (matches.size() * code_width() <= 64) {
+    for (size_t m = 0; m < matches.size(); ++m) {
+      result += count_code(matches[m]);
+    }
+    return result;
+  }
+  // Too many codes match to test them one at a time, so count every
+  // code instead.
+  vector<size_t> counts;
+  counts.resize(values.size());
+  const unsigned per_word = 1u << log_codes_per_word();
+  const word_t mask = code_mask();
+  for (size_t j = 0; j < words.size(); ++j) {
+    const word_t w = words[j];
+    const unsigned end = (words.size() == j + 1)
+      ? static_cast<unsigned>(item_count - (j << log_codes_per_word()))
+      : per_word;
+    for (unsigned t = 0; t < end; ++t) {
+      ++counts[static_cast<size_t>((w >> (t << log_code_width)) & mask)];
+    }
+  }
+  for (size_t m = 0; m < matches.size(); ++m) {
+    result += counts[matches[m]];
+  }
+  return result;
+}
+
+} // namespace succinct
+#endif
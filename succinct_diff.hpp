@@ -0,0 +1,133 @@
+/*
+Differences between two succinct vectors, for replication.
+
+diff(a, b) produces a patch listing the ranges of items in which b
+differs from a, plus the items of b in those ranges. apply_patch(v, p)
+turns a copy of a into a copy of b.
+
+When a and b have the same shape, full buffers with the same cached
+hash (see vector::rehash) are assumed to be equal and skipped in
+O(1). Two different buffers have the same hash with probability about
+2^-64. Other buffers are compared with memcmp where possible.
+
+ */
+
+#ifndef SUCCINCT_DIFF_HPP
+#define SUCCINCT_DIFF_HPP
+
+#include <cassert>
+#include <utility>
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+template<typename T>
+struct patch {
+  typedef std::size_t size_t;
+  // The size of the vector after the patch is applied
+  size_t size;
+  // The changed ranges, as (first index, number of items), in
+  // increasing order
+  vector<std::pair<size_t, size_t> > ranges;
+  // The new items in every range, concatenated
+  vector<T> items;
+
+  patch() : size(0), ranges(), items() {}
+
+  // Record that the n items starting at index are now those at x.
+  // Ranges that touch are merged.
+  void
+  add(const size_t index, const T * const x, const size_t n) {
+    if (0 == n) {
+      return;
+    }
+    const size_t count = ranges.size();
+    if ((count > 0)
+        and (ranges[count-1].first + ranges[count-1].second == index)) {
+      ranges[count-1].second += n;
+    } else {
+      ranges.push_back(std::make_pair(index, n));
+    }
+    for (size_t i = 0; i < n; ++i) {
+      items.push_back(x[i]);
+    }
+  }
+};
+
+// A patch that turns a into b. Θ(n) worst case, O(\sqrt{n}) if a and
+// b have the same shape, have cached hashes (see vector::rehash) and
+// differ in O(1) buffers.
+template<typename T>
+patch<T>
+diff(const vector<T> & a, const vector<T> & b) {
+  patch<T> result;
+  result.size = b.size();
+  const size_t n = std::min(a.size(), b.size());
+  const size_t a_cap = a.segment_capacity();
+  const size_t b_cap = b.segment_capacity();
+  const bool same_shape = (a_cap == b_cap);
+  // Both capacities are powers of 2, so no chunk straddles a segment
+  const size_t chunk = std::min(a_cap, b_cap);
+  for (size_t i = 0; i < n; i += chunk) {
+    const size_t len = std::min(chunk, n - i);
+    const size_t k = i / chunk;
+    if (same_shape
+        and (k + 1 < a.segment_count())
+        and (k + 1 < b.segment_count())
+        and (0 != a.cached_segment_hash(k))
+        and (a.cached_segment_hash(k) == b.cached_segment_hash(k))) {
+      continue;
+    }
+    const T * const x = a.segment(i / a_cap) + (i & (a_cap - 1));
+    const T * const y = b.segment(i / b_cap) + (i & (b_cap - 1));
+    size_t j = 0;
+    while (j < len) {
+      j += first_difference(x + j, y + j, len - j);
+      const size_t start = j;
+      while ((j < len) and not (x[j] == y[j])) {
+        ++j;
+      }
+      result.add(i + start, y + start, j - start);
+    }
+  }
+  // Items past the end of a
+  for (size_t i = n; i < b.size(); ) {
+    const size_t k = i / b_cap;
+    const size_t offset = i & (b_cap - 1);
+    const size_t len = std::min(b.segment_size(k) - offset, b.size() - i);
+    result.add(i, b.segment(k) + offset, len);
+    i += len;
+  }
+  return result;
+}
+
+// Apply a patch made by diff(a, b) to a copy of a, making it a copy of
+// b. Θ(size of the patch) plus the cost of resizing.
+template<typename T>
+void
+apply_patch(vector<T> & v, const patch<T> & p) {
+  v.resize(p.size);
+  const size_t cap = v.segment_capacity();
+  size_t from = 0;
+  for (size_t r = 0; r < p.ranges.size(); ++r) {
+    size_t i = p.ranges[r].first;
+    const size_t end = i + p.ranges[r].second;
+    assert (end <= v.size());
+    while (i < end) {
+      const size_t k = i / cap;
+      const size_t offset = i & (cap - 1);
+      const size_t len = std::min(cap - offset, end - i);
+      T * const out = v.segment(k) + offset;
+      for (size_t j = 0; j < len; ++j) {
+        out[j] = p.items[from + j];
+      }
+      from += len;
+      i += len;
+    }
+  }
+  assert (from == p.items.size());
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,187 @@
+/*
+Stream compaction: copying the items of a succinct vector that satisfy
+a predicate into a new vector.
+
+Each buffer is processed in chunks. The predicate is first evaluated
+on every item of the chunk into a byte mask, which is a simple loop
+the compiler can vectorize when the predicate is simple. The kept
+items are then compacted into a staging area and appended to the
+result's last buffer with vector::append. When compiled with AVX2 and
+BMI2, 4-byte items and indexes are compacted 8 at a time with a
+permutation computed by pext; otherwise the compaction is branchless.
+
+ */
+
+#ifndef SUCCINCT_FILTER_HPP
+#define SUCCINCT_FILTER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+#include <type_traits>
+#if defined(__AVX2__) && defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+// The number of items filtered at a time
+static const std::size_t filter_chunk = 256;
+
+// Copy x[j] to out for each j < n with keep[j] == 1, returning the
+// number copied. out must have room for n + 8 items.
+template<typename T>
+std::size_t
+compact(const T * const x, const unsigned char * const keep,
+        const std::size_t n, T * const out) {
+  std::size_t k = 0;
+  if (std::is_trivially_copyable<T>::value and (sizeof(T) <= 16)) {
+    // Write every item, but only move past the kept ones. This avoids
+    // a hard-to-predict branch per item.
+    for (std::size_t j = 0; j < n; ++j) {
+      out[k] = x[j];
+      k += keep[j];
+    }
+  } else {
+    for (std::size_t j = 0; j < n; ++j) {
+      if (keep[j]) {
+        out[k++] = x[j];
+      }
+    }
+  }
+  return k;
+}
+
+// Write base + j to out for each j < n with keep[j] == 1, returning the
+// number written. out must have room for n + 8 indexes.
+inline std::size_t
+compact_indices(const std::uint32_t base, const unsigned char * const keep,
+                const std::size_t n, std::uint32_t * const out) {
+  std::size_t j = 0;
+  std::size_t k = 0;
+#if defined(__AVX2__) && defined(__BMI2__)
+  const __m256i iota = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+  for (; j + 8 <= n; j += 8) {
+    std::uint64_t bytes;
+    std::memcpy(&bytes, keep + j, sizeof(bytes));
+    // Kept lanes become 0xff; pext then gathers their lane numbers.
+    const std::uint64_t lanes = _pext_u64(0x0706050403020100ull, bytes * 0xff);
+    const __m256i permutation =
+      _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<long long>(lanes)));
+    const __m256i indices = _mm256_add_epi32(
+      _mm256_set1_epi32(static_cast<int>(base + j)), iota);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k),
+                        _mm256_permutevar8x32_epi32(indices, permutation));
+    k += static_cast<std::size_t>(__builtin_popcountll(bytes));
+  }
+#endif
+  for (; j < n; ++j) {
+    out[k] = static_cast<std::uint32_t>(base + j);
+    k += keep[j];
+  }
+  return k;
+}
+
+#if defined(__AVX2__) && defined(__BMI2__)
+// 4-byte items are compacted like indexes
+template<typename T>
+std::size_t
+compact_words(const T * const x, const unsigned char * const keep,
+              const std::size_t n, T * const out) {
+  std::size_t j = 0;
+  std::size_t k = 0;
+  for (; j + 8 <= n; j += 8) {
+    std::uint64_t bytes;
+    std::memcpy(&bytes, keep + j, sizeof(bytes));
+    const std::uint64_t lanes = _pext_u64(0x0706050403020100ull, bytes * 0xff);
+    const __m256i permutation =
+      _mm256_cvtepu8_epi32(_mm_cvtsi64_si128(static_cast<long long>(lanes)));
+    const __m256i items =
+      _mm256_loadu_si256(reinterpret_cast<const __m256i *>(x + j));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + k),
+                        _mm256_permutevar8x32_epi32(items, permutation));
+    k += static_cast<std::size_t>(__builtin_popcountll(bytes));
+  }
+  return k + compact(x + j, keep + j, n - j, out + k);
+}
+
+template<typename T>
+std::size_t
+compact_dispatch(const T * const x, const unsigned char * const keep,
+                 const std::size_t n, T * const out, std::true_type) {
+  return compact_words(x, keep, n, out);
+}
+#endif
+
+template<typename T>
+std::size_t
+compact_dispatch(const T * const x, const unsigned char * const keep,
+                 const std::size_t n, T * const out, std::false_type) {
+  return compact(x, keep, n, out);
+}
+
+// Call f(index of first item, items, keep mask, number of items) on
+// each chunk of v, with the mask filled in by pred.
+template<typename T, typename Predicate, typename Function>
+void
+for_each_filtered_chunk(const vector<T> & v, Predicate & pred, Function f) {
+  unsigned char keep[filter_chunk];
+  std::size_t index = 0;
+  for (std::size_t k = 0; k < v.segment_count(); ++k) {
+    const T * const x = v.segment(k);
+    const std::size_t m = v.segment_size(k);
+    for (std::size_t j0 = 0; j0 < m; j0 += filter_chunk) {
+      const std::size_t len = std::min(filter_chunk, m - j0);
+      for (std::size_t j = 0; j < len; ++j) {
+        keep[j] = pred(x[j0 + j]) ? 1 : 0;
+      }
+      f(index, x + j0, keep, len);
+      index += len;
+    }
+  }
+}
+
+template<typename T, typename Predicate>
+vector<T>
+filter(const vector<T> & v, Predicate pred) {
+  vector<T> result;
+  T staging[filter_chunk + 8];
+  for_each_filtered_chunk(v, pred,
+    [&](std::size_t, const T * const x, const unsigned char * const keep,
+        const std::size_t len) {
+      const std::size_t n = compact_dispatch(
+        x, keep, len, staging,
+#if defined(__AVX2__) && defined(__BMI2__)
+        std::integral_constant<bool, (4 == sizeof(T))
+                               and std::is_trivially_copyable<T>::value>()
+#else
+        std::false_type()
+#endif
+        );
+      result.append(staging, staging + n);
+    });
+  return result;
+}
+
+// The indexes of the items satisfying pred. v must have fewer than
+// 2^32 items.
+template<typename T, typename Predicate>
+vector<std::uint32_t>
+filter_indices(const vector<T> & v, Predicate pred) {
+  assert (v.size() < (static_cast<std::size_t>(1) << 32));
+  vector<std::uint32_t> result;
+  std::uint32_t staging[filter_chunk + 8];
+  for_each_filtered_chunk(v, pred,
+    [&](const std::size_t index, const T *, const unsigned char * const keep,
+        const std::size_t len) {
+      const std::size_t n = compact_indices(
+        static_cast<std::uint32_t>(index), keep, len, staging);
+      result.append(staging, staging + n);
+    });
+  return result;
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,608 @@
+/*
+Saving succinct vectors to files and loading them back, with the
+buffers read and written in parallel.
+
+The file is a 4096-byte header, then the items in order, then (at the
+next multiple of 4096 bytes) a trailer holding the CRC32C of each block
+of items, where the blocks are the buffers of the vector that saved
+the file. Apart from the block size, the file does not depend on the
+shape of the vector. load checks every block; a mapped_vector checks
+each block when it is first read (see succinct_mapped_vector.hpp). Each buffer
+is one contiguous run of the file, and all of them are transferred at
+once: through io_uring where the kernel supports it, with up to
+queue_depth requests in flight, and otherwise by a pool of threads
+calling pread and pwrite.
+
+With the direct option, the file is opened with O_DIRECT, bypassing
+the page cache. Since buffers are not allocated with the alignment
+O_DIRECT needs, they are copied through aligned staging buffers,
+queue_depth at a time. Direct I/O is used only when the buffers are a
+multiple of 4096 bytes, and only if the file system supports it.
+
+Items must be trivially copyable, since they are written as bytes.
+This uses POSIX I/O, and throws std::runtime_error if it fails.
+
+ */
+
+#ifndef SUCCINCT_IO_HPP
+#define SUCCINCT_IO_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SUCCINCT_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+#include "succinct_vector.hpp"
+#include "succinct_parallel.hpp"
+#include "succinct_aggregate.hpp"
+#include "succinct_crc32c.hpp"
+
+namespace succinct {
+
+struct io_options {
+  // The number of threads for the pread/pwrite fallback, or 0 for one
+  // per hardware thread
+  unsigned threads;
+  // The number of requests io_uring keeps in flight, and the number of
+  // staging buffers for direct I/O
+  unsigned queue_depth;
+  // Open the file with O_DIRECT
+  bool direct;
+  // Try io_uring before falling back to threads
+  bool use_io_uring;
+  // Check the checksums when loading
+  bool verify;
+
+  io_options() : 
+    threads(0), queue_depth(32), direct(false), use_io_uring(true), verify(true) {}
+};
+
+// The alignment O_DIRECT needs, and the size of the file header
+static const std::size_t io_alignment = 4096;
+
+// A read or write of length bytes at data to or from offset in the
+// file. A read that reaches the end of the file is complete once
+// required bytes are read.
+struct io_request {
+  unsigned char * data;
+  std::size_t length;
+  std::size_t required;
+  off_t offset;
+};
+
+inline std::size_t
+io_round_up(const std::size_t n) {
+  return (n + io_alignment - 1) & ~(io_alignment - 1);
+}
+
+// Do one request with pread or pwrite. Returns false on failure.
+inline bool
+transfer_fully(const int fd, const bool write, const io_request & r) {
+  std::size_t done = 0;
+  while (done < r.length) {
+    const off_t at = r.offset + static_cast<off_t>(done);
+    const ssize_t n = write
+      ? ::pwrite(fd, r.data + done, r.length - done, at)
+      : ::pread(fd, r.data + done, r.length - done, at);
+    if ((n < 0) and (EINTR == errno)) {
+      continue;
+    }
+    if (n < 0) {
+      return false;
+    }
+    if (0 == n) {
+      return (not write) and (done >= r.required);
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+// Do the requests on a pool of threads, each taking the next request
+// when it finishes one.
+inline void
+transfer_threads(const int fd, const bool write,
+                 const vector<io_request> & requests, const unsigned threads) {
+  const std::size_t count = requests.size();
+  std::atomic<std::size_t> next(0);
+  std::atomic<bool> failed(false);
+  const unsigned t_count = thread_count(threads, count);
+  parallel_ranges(t_count, t_count,
+    [&](unsigned, std::size_t, std::size_t) {
+      for (std::size_t r; (r = next.fetch_add(1)) < count; ) {
+        if (not transfer_fully(fd, write, requests[r])) {
+          failed = true;
+          return;
+        }
+      }
+    });
+  if (failed) {
+    throw std::runtime_error("succinct: file transfer failed");
+  }
+}
+
+#ifdef SUCCINCT_HAVE_IO_URING
+// A minimal io_uring submission and completion queue, using the
+// system calls directly.
+struct io_ring {
+public:
+  io_ring() :
+    ring_fd(-1), entries(0), sq_ring(0), sq_ring_bytes(0), cq_ring(0),
+    cq_ring_bytes(0), sqes(0), sqes_bytes(0)
+  {}
+  io_ring(const io_ring &) = delete;
+  io_ring & operator=(const io_ring &) = delete;
+
+  ~io_ring() {
+    if (0 != sqes) {
+      ::munmap(sqes, sqes_bytes);
+    }
+    if ((0 != cq_ring) and (cq_ring != sq_ring)) {
+      ::munmap(cq_ring, cq_ring_bytes);
+    }
+    if (0 != sq_ring) {
+      ::munmap(sq_ring, sq_ring_bytes);
+    }
+    if (ring_fd >= 0) {
+      ::close(ring_fd);
+    }
+  }
+
+  // Set up a ring with room for depth requests. Returns false if the
+  // kernel does not support io_uring or does not allow it.
+  bool
+  setup(const unsigned depth) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, depth, &params));
+    if (ring_fd < 0) {
+      return false;
+    }
+    entries = params.sq_entries;
+    sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_bytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single = (0 != (params.features & IORING_FEAT_SINGLE_MMAP));
+    if (single) {
+      sq_ring_bytes = cq_ring_bytes = std::max(sq_ring_bytes, cq_ring_bytes);
+    }
+    sq_ring = map(sq_ring_bytes, IORING_OFF_SQ_RING);
+    if (0 == sq_ring) {
+      return false;
+    }
+    cq_ring = single ? sq_ring : map(cq_ring_bytes, IORING_OFF_CQ_RING);
+    sqes_bytes = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe *>(
+      static_cast<void *>(map(sqes_bytes, IORING_OFF_SQES)));
+    if ((0 == cq_ring) or (0 == sqes)) {
+      return false;
+    }
+    sq_head = field(sq_ring, params.sq_off.head);
+    sq_tail = field(sq_ring, params.sq_off.tail);
+    sq_mask = field(sq_ring, params.sq_off.ring_mask);
+    sq_array = field(sq_ring, params.sq_off.array);
+    cq_head = field(cq_ring, params.cq_off.head);
+    cq_tail = field(cq_ring, params.cq_off.tail);
+    cq_mask = field(cq_ring, params.cq_off.ring_mask);
+    cqes = static_cast<io_uring_cqe *>(
+      static_cast<void *>(cq_ring + params.cq_off.cqes));
+    return true;
+  }
+
+  // Do the requests, keeping up to the ring's depth in flight. Short
+  // transfers are resubmitted for the rest.
+  void
+  transfer(const int fd, const bool write, const vector<io_request> & requests) {
+    const std::size_t count = requests.size();
+    vector<iovec> iov;
+    iov.resize(count);
+    vector<std::size_t> done;
+    done.resize(count);
+    std::size_t next = 0;
+    std::size_t in_flight = 0;
+    unsigned to_submit = 0;
+    bool failed = false;
+    while ((in_flight > 0) or ((next < count) and not failed)) {
+      while ((in_flight < entries) and (next < count) and not failed) {
+        queue(fd, write, requests[next], next, iov[next], 0);
+        ++next;
+        ++in_flight;
+        ++to_submit;
+      }
+      const long submitted = ::syscall(__NR_io_uring_enter, ring_fd, to_submit, 1,
+                                       IORING_ENTER_GETEVENTS, 0, 0);
+      if (submitted < 0) {
+        if (EINTR == errno) {
+          continue;
+        }
+        throw std::runtime_error("succinct: io_uring_enter failed");
+      }
+      to_submit -= static_cast<unsigned>(submitted);
+      unsigned head = *cq_head;
+      const unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+      for (; head != tail; ++head) {
+        const io_uring_cqe & cqe = cqes[head & *cq_mask];
+        const std::size_t r = static_cast<std::size_t>(cqe.user_data);
+        const io_request & request = requests[r];
+        if (cqe.res > 0) {
+          done[r] += static_cast<std::size_t>(cqe.res);
+        }
+        if ((cqe.res < 0)
+            or ((0 == cqe.res) and (write or (done[r] < request.required)))) {
+          // Let everything in flight finish before giving up, since
+          // the kernel is still using the buffers.
+          failed = true;
+          --in_flight;
+        } else if ((cqe.res > 0) and (done[r] < request.length) and not failed) {
+          queue(fd, write, request, r, iov[r], done[r]);
+          ++to_submit;
+        } else {
+          --in_flight;
+        }
+      }
+      __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+    if (failed) {
+      throw std::runtime_error("succinct: file transfer failed");
+    }
+  }
+
+protected:
+  int ring_fd;
+  unsigned entries;
+  unsigned char * sq_ring;
+  std::size_t sq_ring_bytes;
+  unsigned char * cq_ring;
+  std::size_t cq_ring_bytes;
+  io_uring_sqe * sqes;
+  std::size_t sqes_bytes;
+  unsigned * sq_head;
+  unsigned * sq_tail;
+  unsigned * sq_mask;
+  unsigned * sq_array;
+  unsigned * cq_head;
+  unsigned * cq_tail;
+  unsigned * cq_mask;
+  io_uring_cqe * cqes;
+
+  unsigned char *
+  map(const std::size_t bytes, const off_t offset) const {
+    void * const result = ::mmap(0, bytes, PROT_READ | PROT_WRITE,
+                                 MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+    return (MAP_FAILED == result) ? 0 : static_cast<unsigned char *>(result);
+  }
+
+  static unsigned *
+  field(unsigned char * const ring, const unsigned offset) {
+    return static_cast<unsigned *>(static_cast<void *>(ring + offset));
+  }
+
+  // Add the part of request r after its first done bytes to the
+  // submission queue.
+  void
+  queue(const int fd, const bool write, const io_request & request,
+        const std::size_t r, iovec & iov, const std::size_t done) {
+    iov.iov_base = request.data + done;
+    iov.iov_len = request.length - done;
+    const unsigned tail = *sq_tail;
+    const unsigned index = tail & *sq_mask;
+    io_uring_sqe & sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = write ? IORING_OP_WRITEV : IORING_OP_READV;
+    sqe.fd = fd;
+    sqe.addr = reinterpret_cast<std::uint64_t>(&iov);
+    sqe.len = 1;
+    sqe.off = static_cast<std::uint64_t>(request.offset) + done;
+    sqe.user_data = r;
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+  }
+};
+#endif
+
+// Do the requests, through io_uring if possible, otherwise on threads.
+inline void
+transfer(const int fd, const bool write, const vector<io_request> & requests,
+         const io_options & options) {
+  if (0 == requests.size()) {
+    return;
+  }
+#ifdef SUCCINCT_HAVE_IO_URING
+  if (options.use_io_uring) {
+    io_ring ring;
+    if (ring.setup(std::max(1u, options.queue_depth))) {
+      ring.transfer(fd, write, requests);
+      return;
+    }
+  }
+#endif
+  transfer_threads(fd, write, requests, options.threads);
+}
+
+// An aligned block of memory for direct I/O, freed on scope exit
+struct aligned_bytes {
+  unsigned char * data;
+
+  explicit aligned_bytes(const std::size_t n) : data(0) {
+    void * p = 0;
+    if (0 != ::posix_memalign(&p, io_alignment, std::max(n, io_alignment))) {
+      throw std::runtime_error("succinct: cannot allocate staging buffers");
+    }
+    data = static_cast<unsigned char *>(p);
+  }
+  aligned_bytes(const aligned_bytes &) = delete;
+  aligned_bytes & operator=(const aligned_bytes &) = delete;
+  ~aligned_bytes() { std::free(data); }
+};
+
+struct io_header {
+  char magic[8];
+  // 1 for files without checksums, 2 for files with them
+  std::uint64_t version;
+  std::uint64_t item_bytes;
+  std::uint64_t size;
+  // The number of items in each checksummed block, and where the
+  // checksums start
+  std::uint64_t block_items;
+  std::uint64_t trailer_offset;
+
+  std::size_t
+  block_count() const {
+    return (version < 2) ? 0
+      : static_cast<std::size_t>((size + block_items - 1) / block_items);
+  }
+};
+
+// Read and check the header of the file open as fd.
+inline io_header
+read_header(const int fd, const std::size_t item_bytes) {
+  aligned_bytes header(io_alignment);
+  const io_request r = {header.data, io_alignment, sizeof(io_header), 0};
+  if (not transfer_fully(fd, false, r)) {
+    throw std::runtime_error("succinct: cannot read file header");
+  }
+  io_header h;
+  std::memcpy(&h, header.data, sizeof(h));
+  if ((0 != std::memcmp(h.magic, "SUCCVEC", 8)) 
+      or (h.version < 1) or (h.version > 2)
+      or (item_bytes != h.item_bytes)
+      or ((2 == h.version) and (0 == h.block_items))) {
+    throw std::runtime_error("succinct: not a file of this item type");
+  }
+  return h;
+}
+
+// The CRC32C of the items of v in [first, last)
+template<typename T>
+std::uint32_t
+items_crc32c(const vector<T> & v, const std::size_t first, const std::size_t last) {
+  std::uint32_t result = 0;
+  for_each_chunk(v, first, last, [&](const T * const x, const std::size_t n) {
+    result = crc32c(result, x, n * sizeof(T));
+  });
+  return result;
+}
+
+// Open path, with O_DIRECT if direct is true and the file system
+// supports it, in which case direct is left true.
+inline int
+open_file(const char * const path, const int flags, bool & direct) {
+  if (direct) {
+    const int fd = ::open(path, flags | O_DIRECT, 0644);
+    if (fd >= 0) {
+      return fd;
+    }
+    direct = false;
+  }
+  const int fd = ::open(path, flags, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("succinct: cannot open file");
+  }
+  return fd;
+}
+
+
+// Do one request per segment of a vector with the given segment
+// pointers and sizes, in place or, if direct, through staging buffers.
+// Before writes, stage(k, staging) must fill the staging area for
+// segment k; after reads, unstage(k, staging) empties it.
+template<typename Stage, typename Unstage>
+void
+transfer_segments(const int fd, const bool write, const bool direct,
+                  const vector<unsigned char *> & segments,
+                  const std::size_t segment_bytes,
+                  const std::size_t last_bytes,
+                  const io_options & options, Stage stage, Unstage unstage) {
+  const std::size_t segment_count = segments.size();
+  vector<io_request> requests;
+  if (not direct) {
+    for (std::size_t k = 0; k < segment_count; ++k) {
+      const std::size_t bytes = (k + 1 == segment_count) ? last_bytes : segment_bytes;
+      if (bytes > 0) {
+        const io_request r = {segments[k], bytes, bytes,
+                              static_cast<off_t>(io_alignment + k * segment_bytes)};
+        requests.push_back(r);
+      }
+    }
+    transfer(fd, write, requests, options);
+    return;
+  }
+  const std::size_t batch = std::max(1u, options.queue_depth);
+  aligned_bytes staging(batch * segment_bytes);
+  for (std::size_t first = 0; first < segment_count; first += batch) {
+    const std::size_t last = std::min(segment_count, first + batch);
+    requests.resize(0);
+    for (std::size_t k = first; k < last; ++k) {
+      const std::size_t bytes = (k + 1 == segment_count) ? last_bytes : segment_bytes;
+      if (0 == bytes) {
+        continue;
+      }
+      unsigned char * const buffer = staging.data + (k - first) * segment_bytes;
+      if (write) {
+        stage(k, buffer);
+      }
+      // The last segment is padded out to the alignment.
+      const io_request r = {buffer, io_round_up(bytes), bytes,
+                            static_cast<off_t>(io_alignment + k * segment_bytes)};
+      requests.push_back(r);
+    }
+    transfer(fd, write, requests, options);
+    if (not write) {
+      for (std::size_t k = first; k < last; ++k) {
+        unstage(k, staging.data + (k - first) * segment_bytes);
+      }
+    }
+  }
+}
+
+// Write v to the file at path, replacing it. Θ(n / parallelism).
+template<typename T>
+void
+save(const vector<T> & v, const char * const path,
+     const io_options & options = io_options()) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "save writes items as bytes");
+  const std::size_t segment_bytes = v.segment_capacity() * sizeof(T);
+  bool direct = options.direct and (0 == segment_bytes % io_alignment);
+  const int fd = open_file(path, O_WRONLY | O_CREAT | O_TRUNC, direct);
+  try {
+    aligned_bytes header(io_alignment);
+    std::memset(header.data, 0, io_alignment);
+    const std::size_t cap = v.segment_capacity();
+    const io_header h = {{'S', 'U', 'C', 'C', 'V', 'E', 'C', 0}, 2, sizeof(T), 
+                         v.size(), cap, 
+                         io_round_up(io_alignment + v.size() * sizeof(T))};
+    std::memcpy(header.data, &h, sizeof(h));
+    const io_request r = {header.data, io_alignment, io_alignment, 0};
+    if (not transfer_fully(fd, true, r)) {
+      throw std::runtime_error("succinct: cannot write file header");
+    }
+    vector<unsigned char *> segments;
+    for (std::size_t k = 0; k < v.segment_count(); ++k) {
+      // Writes only read from the segments.
+      segments.push_back(reinterpret_cast<unsigned char *>(const_cast<T *>(v.segment(k))));
+    }
+    const std::size_t last = v.segment_count() - 1;
+    transfer_segments(fd, true, direct, segments,
+                      segment_bytes, v.segment_size(last) * sizeof(T), options,
+      [&](const std::size_t k, unsigned char * const to) {
+        std::memcpy(to, segments[k], v.segment_size(k) * sizeof(T));
+      },
+      [](std::size_t, unsigned char *) {});
+    // The trailer, with one checksum per segment
+    const std::size_t blocks = h.block_count();
+    aligned_bytes trailer(io_round_up(blocks * sizeof(std::uint32_t)));
+    std::uint32_t * const crcs = static_cast<std::uint32_t *>(
+      static_cast<void *>(trailer.data));
+    parallel_ranges(blocks, thread_count(options.threads, blocks),
+      [&](unsigned, const std::size_t first, const std::size_t last) {
+        for (std::size_t b = first; b < last; ++b) {
+          crcs[b] = items_crc32c(v, b * cap, std::min(v.size(), (b + 1) * cap));
+        }
+      });
+    const io_request t = {trailer.data, io_round_up(blocks * sizeof(std::uint32_t)),
+                          0, static_cast<off_t>(h.trailer_offset)};
+    if ((blocks > 0) and not transfer_fully(fd, true, t)) {
+      throw std::runtime_error("succinct: cannot write checksums");
+    }
+    // Direct writes were padded.
+    if (0 != ::ftruncate(fd, static_cast<off_t>(h.trailer_offset 
+                                                + blocks * sizeof(std::uint32_t)))) {
+      throw std::runtime_error("succinct: cannot set file size");
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+}
+
+// Replace the items of v with those in the file at path, which must
+// have been written by save with the same item size. v takes the
+// smallest shape for its new size, with no reservation, and its
+// buffers are read into without being initialized first. Unless
+// options.verify is false, every block is checked against its
+// checksum. If this throws, v may already hold some or none of the
+// items. Θ(n / parallelism).
+template<typename T>
+void
+load(vector<T> & v, const char * const path,
+     const io_options & options = io_options()) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "load reads items as bytes");
+  bool direct = options.direct;
+  const int fd = open_file(path, O_RDONLY, direct);
+  try {
+    const io_header h = read_header(fd, sizeof(T));
+    // The reads fill every item, so the buffers are not initialized.
+    vector_access::shape_for_overwrite(v, static_cast<std::size_t>(h.size));
+    const std::size_t segment_bytes = v.segment_capacity() * sizeof(T);
+    if (direct and (0 != segment_bytes % io_alignment)) {
+      // The reads would not be aligned.
+      direct = false;
+      ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_DIRECT);
+    }
+    const vector<T *> segments = segment_pointers(v);
+    vector<unsigned char *> bytes;
+    for (std::size_t k = 0; k < segments.size(); ++k) {
+      bytes.push_back(reinterpret_cast<unsigned char *>(segments[k]));
+    }
+    const std::size_t last = v.segment_count() - 1;
+    transfer_segments(fd, false, direct, bytes,
+                      segment_bytes, v.segment_size(last) * sizeof(T), options,
+      [](std::size_t, unsigned char *) {},
+      [&](const std::size_t k, const unsigned char * const from) {
+        std::memcpy(bytes[k], from, v.segment_size(k) * sizeof(T));
+      });
+    const std::size_t blocks = h.block_count();
+    if (options.verify and (blocks > 0)) {
+      aligned_bytes trailer(io_round_up(blocks * sizeof(std::uint32_t)));
+      const io_request t = {trailer.data, io_round_up(blocks * sizeof(std::uint32_t)),
+                            blocks * sizeof(std::uint32_t),
+                            static_cast<off_t>(h.trailer_offset)};
+      if (not transfer_fully(fd, false, t)) {
+        throw std::runtime_error("succinct: cannot read checksums");
+      }
+      const std::uint32_t * const crcs = static_cast<const std::uint32_t *>(
+        static_cast<const void *>(trailer.data));
+      const std::size_t block_items = static_cast<std::size_t>(h.block_items);
+      std::atomic<bool> corrupt(false);
+      parallel_ranges(blocks, thread_count(options.threads, blocks),
+        [&](unsigned, const std::size_t first, const std::size_t last) {
+          for (std::size_t b = first; b < last; ++b) {
+            const std::size_t end = std::min(v.size(), (b + 1) * block_items);
+            if (items_crc32c(v, b * block_items, end) != crcs[b]) {
+              corrupt = true;
+            }
+          }
+        });
+      if (corrupt) {
+        throw std::runtime_error("succinct: checksum mismatch");
+      }
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+}
+
+} // namespace succinct
+#endif
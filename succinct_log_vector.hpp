@@ -0,0 +1,285 @@
+/*
+An append-only succinct vector that other threads can follow as it
+grows, like tail -f.
+
+One thread appends with push_back. Items are published to readers a
+buffer at a time: when a buffer fills, and when flush() or close() is
+called. Readers subscribe from some index and receive the published
+items after it in batches; a reader waiting for items is woken once
+per publication, not once per item.
+
+Since published items are never written again, the appender only
+takes the lock when it publishes, which is also the only time it can
+rebuild. Readers copy items out under the lock, so they never see a
+rebuild in progress.
+
+In C++20, a subscription can also be read as a generator of batches,
+each a std::span. This blocks like the rest of the interface; an
+asynchronous consumer should run it on its own thread.
+
+ */
+
+#ifndef SUCCINCT_LOG_VECTOR_HPP
+#define SUCCINCT_LOG_VECTOR_HPP
+
+#include <cassert>
+#include <condition_variable>
+#include <mutex>
+#if __cplusplus >= 202002L
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <span>
+#endif
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+#if __cplusplus >= 202002L
+// A minimal generator: a range over the values a coroutine yields by
+// co_yield. Each value is only valid until the iterator is advanced.
+template<typename U>
+struct generator {
+public:
+  struct promise_type {
+    const U * value;
+
+    generator
+    get_return_object() {
+      return generator(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    std::suspend_always
+    yield_value(const U & x) noexcept {
+      value = &x;
+      return {};
+    }
+    void return_void() {}
+    void unhandled_exception() { throw; }
+  };
+
+  struct iterator {
+    std::coroutine_handle<promise_type> coroutine;
+
+    const U & operator*() const { return *coroutine.promise().value; }
+    iterator & operator++() { coroutine.resume(); return *this; }
+    void operator++(int) { coroutine.resume(); }
+    bool 
+    operator==(std::default_sentinel_t) const { 
+      return coroutine.done(); 
+    }
+    typedef std::ptrdiff_t difference_type;
+    typedef U value_type;
+  };
+
+  explicit generator(const std::coroutine_handle<promise_type> h) : coroutine(h) {}
+  generator(generator && that) : coroutine(that.coroutine) { that.coroutine = {}; }
+  generator(const generator &) = delete;
+  generator & operator=(const generator &) = delete;
+  ~generator() {
+    if (coroutine) {
+      coroutine.destroy();
+    }
+  }
+
+  iterator
+  begin() {
+    coroutine.resume();
+    return iterator{coroutine};
+  }
+  std::default_sentinel_t end() const { return {}; }
+
+private:
+  std::coroutine_handle<promise_type> coroutine;
+};
+#endif
+
+template<typename T>
+struct log_vector : protected vector<T> {
+public:
+  typedef std::size_t size_t;
+
+  // A reader's position in the vector. Subscriptions are cheap to
+  // copy, and each copy reads independently.
+  struct subscription {
+  public:
+    subscription(const log_vector * const that, const size_t from) :
+      v(that), position(from) {}
+    // Wait until an item after the position is published or the
+    // vector is closed, then copy up to max of the published items to
+    // out and move past them. Returns the number copied, which is 0
+    // only once the vector is closed and every item has been read.
+    size_t next(T * const out, const size_t max);
+    // Like next, but returns 0 instead of waiting.
+    size_t try_next(T * const out, const size_t max);
+    // The index of the next item to be read
+    size_t index() const { return position; }
+#if __cplusplus >= 202002L
+    // The items after the position, in batches of at most max items
+    generator<std::span<const T> > batches(const size_t max);
+#endif
+
+  protected:
+    const log_vector * v;
+    size_t position;
+  };
+
+  log_vector();
+  log_vector(const log_vector &) = delete;
+  log_vector & operator=(const log_vector &) = delete;
+  // Only the appending thread may call size(), push_back(), flush()
+  // and close().
+  using vector<T>::size;
+  // Add an item to the end. It is published when its buffer fills.
+  // O(1) amortized, Θ(n) worst case.
+  void push_back(const T &);
+  // Publish every item added so far.
+  void flush();
+  // Publish every item added so far, and tell readers that there will
+  // be no more.
+  void close();
+  // The number of items readers can see. Any thread may call this.
+  size_t published() const;
+  // Follow the vector from item from, which need not be published yet.
+  subscription subscribe(const size_t from = 0) const;
+
+protected:
+  typedef typename vector<T>::length_t length_t;
+
+  mutable std::mutex mutex;
+  mutable std::condition_variable changed;
+  // These are only accessed under the lock.
+  size_t published_count;
+  bool closed;
+
+  // Publish size() items, with the lock held.
+  void
+  publish() {
+    published_count = size();
+  }
+
+  // Copy up to max published items starting at from to out, with the
+  // lock held. Only the directory entries of published buffers are
+  // read, since the appender may be writing the rest.
+  size_t
+  copy_published(const size_t from, T * out, const size_t max) const {
+    const size_t n = std::min(max, published_count - from);
+    const size_t cap = this->buffer_capacity();
+    for (size_t i = from; i < from + n; ) {
+      const size_t offset = i & (cap - 1);
+      const size_t len = std::min(cap - offset, from + n - i);
+      const T * const x = this->dir[i >> this->log_buffer_capacity] + offset;
+      out = std::copy(x, x + len, out);
+      i += len;
+    }
+    return n;
+  }
+
+}; // struct log_vector
+
+template<typename T>
+log_vector<T>::log_vector() :
+  vector<T>(),
+  mutex(),
+  changed(),
+  published_count(0),
+  closed(false)
+{}
+
+template<typename T>
+void
+log_vector<T>::push_back(const T & x) {
+  if (this->last_buffer_size + 1 < this->buffer_capacity()) {
+    // Neither rebuilds nor publishes, and writes only to the
+    // unpublished part of the last buffer.
+    vector<T>::push_back(x);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    assert (not closed);
+    vector<T>::push_back(x);
+    publish();
+  }
+  changed.notify_all();
+}
+
+template<typename T>
+void
+log_vector<T>::flush() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (published_count == size()) {
+      return;
+    }
+    publish();
+  }
+  changed.notify_all();
+}
+
+template<typename T>
+void
+log_vector<T>::close() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    publish();
+    closed = true;
+  }
+  changed.notify_all();
+}
+
+template<typename T>
+size_t
+log_vector<T>::published() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return published_count;
+}
+
+template<typename T>
+typename log_vector<T>::subscription
+log_vector<T>::subscribe(const size_t from) const {
+  return subscription(this, from);
+}
+
+template<typename T>
+size_t
+log_vector<T>::subscription::next(T * const out, const size_t max) {
+  std::unique_lock<std::mutex> lock(v->mutex);
+  v->changed.wait(lock, [this]() {
+    return (v->published_count > position) or v->closed;
+  });
+  if (v->published_count <= position) {
+    return 0;
+  }
+  const size_t n = v->copy_published(position, out, max);
+  position += n;
+  return n;
+}
+
+template<typename T>
+size_t
+log_vector<T>::subscription::try_next(T * const out, const size_t max) {
+  std::lock_guard<std::mutex> lock(v->mutex);
+  if (v->published_count <= position) {
+    return 0;
+  }
+  const size_t n = v->copy_published(position, out, max);
+  position += n;
+  return n;
+}
+
+#if __cplusplus >= 202002L
+template<typename T>
+generator<std::span<const T> >
+log_vector<T>::subscription::batches(const size_t max) {
+  const std::unique_ptr<T[]> buffer(new T[max]);
+  for (size_t n; (n = next(buffer.get(), max)) > 0; ) {
+    co_yield std::span<const T>(buffer.get(), n);
+  }
+}
+#endif
+
+} // namespace succinct
+#endif
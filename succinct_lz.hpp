@@ -0,0 +1,139 @@
+/*
+A small, fast LZ77-style byte codec, for compressing buffers that are
+not in use.
+
+The compressed form is a sequence of tokens. Each token is a varint
+count of literal bytes, the literal bytes themselves, and then, unless
+the literals reach the end of the input, a varint match length (less
+4) and a 2-byte little-endian offset back into the output. Matches are
+found with a 2^12-entry hash table of 4-byte sequences, keeping only
+the most recent position for each hash, so compression takes one pass
+and decompression is a byte copy loop.
+
+ */
+
+#ifndef SUCCINCT_LZ_HPP
+#define SUCCINCT_LZ_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace succinct {
+
+// The largest compressed size of n bytes
+inline std::size_t
+lz_compress_bound(const std::size_t n) {
+  return n + n / 64 + 16;
+}
+
+inline unsigned char *
+lz_put_varint(unsigned char * out, std::size_t x) {
+  while (x >= 0x80) {
+    *out++ = static_cast<unsigned char>((x & 0x7f) | 0x80);
+    x >>= 7;
+  }
+  *out++ = static_cast<unsigned char>(x);
+  return out;
+}
+
+inline const unsigned char *
+lz_get_varint(const unsigned char * in, std::size_t & x) {
+  x = 0;
+  unsigned shift = 0;
+  while (*in & 0x80) {
+    x |= static_cast<std::size_t>(*in & 0x7f) << shift;
+    shift += 7;
+    ++in;
+  }
+  x |= static_cast<std::size_t>(*in) << shift;
+  return in + 1;
+}
+
+inline std::uint32_t
+lz_hash(const unsigned char * const p) {
+  std::uint32_t x;
+  std::memcpy(&x, p, sizeof(x));
+  return (x * 2654435761u) >> (32 - 12);
+}
+
+// Compress the n bytes at in to out, which must have room for
+// lz_compress_bound(n) bytes. Returns the compressed size.
+inline std::size_t
+lz_compress(const unsigned char * const in, const std::size_t n,
+            unsigned char * const out) {
+  assert (n < (static_cast<std::size_t>(1) << 32));
+  // One more than the most recent position with each hash, or 0
+  std::uint32_t table[1u << 12];
+  std::fill(table, table + (1u << 12), 0);
+
+  unsigned char * op = out;
+  std::size_t anchor = 0;
+  std::size_t ip = 0;
+  while (ip + 4 <= n) {
+    const std::uint32_t h = lz_hash(in + ip);
+    const std::size_t candidate = table[h];
+    table[h] = static_cast<std::uint32_t>(ip + 1);
+    if ((0 == candidate)
+        or (ip + 1 - candidate > 0xffff)
+        or (0 != std::memcmp(in + candidate - 1, in + ip, 4))) {
+      // Skip faster through incompressible stretches
+      ip += 1 + ((ip - anchor) >> 6);
+      continue;
+    }
+    const std::size_t from = candidate - 1;
+    std::size_t length = 4;
+    while ((ip + length < n) and (in[from + length] == in[ip + length])) {
+      ++length;
+    }
+    op = lz_put_varint(op, ip - anchor);
+    op = std::copy(in + anchor, in + ip, op);
+    op = lz_put_varint(op, length - 4);
+    const std::size_t offset = ip - from;
+    *op++ = static_cast<unsigned char>(offset & 0xff);
+    *op++ = static_cast<unsigned char>(offset >> 8);
+    ip += length;
+    anchor = ip;
+  }
+  op = lz_put_varint(op, n - anchor);
+  op = std::copy(in + anchor, in + n, op);
+  assert (static_cast<std::size_t>(op - out) <= lz_compress_bound(n));
+  return static_cast<std::size_t>(op - out);
+}
+
+// Decompress to out, which must have room for the n bytes that were
+// compressed.
+inline void
+lz_decompress(const unsigned char * in, unsigned char * const out,
+              const std::size_t n) {
+  unsigned char * op = out;
+  unsigned char * const end = out + n;
+  for (;;) {
+    std::size_t literals;
+    in = lz_get_varint(in, literals);
+    op = std::copy(in, in + literals, op);
+    in += literals;
+    if (end == op) {
+      return;
+    }
+    std::size_t length;
+    in = lz_get_varint(in, length);
+    length += 4;
+    const std::size_t offset = static_cast<std::size_t>(in[0])
+      | (static_cast<std::size_t>(in[1]) << 8);
+    in += 2;
+    assert (offset <= static_cast<std::size_t>(op - out));
+    assert (length <= static_cast<std::size_t>(end - op));
+    // The match may overlap the bytes it produces, so copy forward
+    // one byte at a time.
+    const unsigned char * from = op - offset;
+    for (std::size_t k = 0; k < length; ++k) {
+      op[k] = from[k];
+    }
+    op += length;
+  }
+}
+
+} // namespace succinct
+#endif
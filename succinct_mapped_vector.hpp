@@ -0,0 +1,233 @@
+/*
+A read-only view of a file written by save (see succinct_io.hpp),
+mapped into memory rather than read.
+
+Opening the view reads only the header, so it is O(1) however large
+the file is. Each block of items is checked against its CRC32C the
+first time an item in it is read; a bitmap records which blocks have
+been checked. A scrub thread can also check the blocks in the
+background, so that corruption in blocks nobody reads is still found.
+
+This uses POSIX I/O, and throws std::runtime_error if it fails or if a
+block does not match its checksum.
+
+ */
+
+#ifndef SUCCINCT_MAPPED_VECTOR_HPP
+#define SUCCINCT_MAPPED_VECTOR_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "succinct_io.hpp"
+#include "succinct_crc32c.hpp"
+
+namespace succinct {
+
+template<typename T>
+struct mapped_vector {
+public:
+  typedef std::size_t size_t;
+  explicit mapped_vector(const char * const path);
+  mapped_vector(const mapped_vector &) = delete;
+  mapped_vector & operator=(const mapped_vector &) = delete;
+  // Stops the scrub thread, if any, without waiting for it to finish.
+  ~mapped_vector();
+  size_t size() const;
+  // Read an item, checking its block first if it has not been checked.
+  // O(1), plus Θ(block size) the first time a block is read.
+  const T & operator[](const size_t) const;
+  // The number of blocks with checksums. Files saved without checksums
+  // have none, and are never checked.
+  size_t block_count() const;
+  size_t verified_blocks() const;
+  // Check block b now, if it has not been checked.
+  void verify(const size_t b) const;
+  // Start a thread that checks every block not yet checked.
+  void start_scrub();
+  // Wait for the scrub thread, throwing if it found a bad block.
+  void finish_scrub();
+
+protected:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "mapped_vector reads items as bytes");
+
+  int fd;
+  unsigned char * base;
+  size_t byte_count;
+  io_header header;
+  const T * items;
+  const std::uint32_t * crcs;
+  // One bit per block, set once the block is checked
+  std::atomic<std::uint64_t> * verified;
+  std::thread * scrubber;
+  std::atomic<bool> stopping;
+  std::atomic<bool> scrub_failed;
+
+  bool
+  is_verified(const size_t b) const {
+    return 0 != (verified[b / 64].load(std::memory_order_acquire)
+                 & (static_cast<std::uint64_t>(1) << (b % 64)));
+  }
+
+  void
+  close_all() {
+    if (0 != base) {
+      ::munmap(base, byte_count);
+    }
+    ::close(fd);
+    delete[] verified;
+  }
+
+}; // struct mapped_vector
+
+template<typename T>
+mapped_vector<T>::mapped_vector(const char * const path) :
+  fd(::open(path, O_RDONLY)),
+  base(0),
+  byte_count(0),
+  header(),
+  items(0),
+  crcs(0),
+  verified(0),
+  scrubber(0),
+  stopping(false),
+  scrub_failed(false)
+{
+  if (fd < 0) {
+    throw std::runtime_error("succinct: cannot open file");
+  }
+  try {
+    header = read_header(fd, sizeof(T));
+    struct stat st;
+    if (0 != ::fstat(fd, &st)) {
+      throw std::runtime_error("succinct: cannot stat file");
+    }
+    byte_count = static_cast<size_t>(st.st_size);
+    const size_t blocks = block_count();
+    if ((byte_count < io_alignment + size() * sizeof(T))
+        or ((blocks > 0) and (byte_count < header.trailer_offset
+                                           + blocks * sizeof(std::uint32_t)))) {
+      throw std::runtime_error("succinct: file is truncated");
+    }
+    void * const p = ::mmap(0, byte_count, PROT_READ, MAP_SHARED, fd, 0);
+    if (MAP_FAILED == p) {
+      throw std::runtime_error("succinct: cannot map file");
+    }
+    base = static_cast<unsigned char *>(p);
+    items = static_cast<const T *>(static_cast<void *>(base + io_alignment));
+    crcs = static_cast<const std::uint32_t *>(
+      static_cast<void *>(base + header.trailer_offset));
+    verified = new std::atomic<std::uint64_t>[blocks / 64 + 1];
+    for (size_t w = 0; w <= blocks / 64; ++w) {
+      verified[w].store(0, std::memory_order_relaxed);
+    }
+  } catch (...) {
+    close_all();
+    throw;
+  }
+}
+
+template<typename T>
+mapped_vector<T>::~mapped_vector() {
+  if (0 != scrubber) {
+    stopping = true;
+    scrubber->join();
+    delete scrubber;
+  }
+  close_all();
+}
+
+template<typename T>
+size_t
+mapped_vector<T>::size() const {
+  return static_cast<size_t>(header.size);
+}
+
+template<typename T>
+const T &
+mapped_vector<T>::operator[](const size_t i) const {
+  assert (i < size());
+  if (block_count() > 0) {
+    const size_t b = i / static_cast<size_t>(header.block_items);
+    if (not is_verified(b)) {
+      verify(b);
+    }
+  }
+  return items[i];
+}
+
+template<typename T>
+size_t
+mapped_vector<T>::block_count() const {
+  return header.block_count();
+}
+
+template<typename T>
+size_t
+mapped_vector<T>::verified_blocks() const {
+  size_t result = 0;
+  for (size_t w = 0; w <= block_count() / 64; ++w) {
+    result += static_cast<size_t>(
+      __builtin_popcountll(verified[w].load(std::memory_order_relaxed)));
+  }
+  return result;
+}
+
+template<typename T>
+void
+mapped_vector<T>::verify(const size_t b) const {
+  assert (b < block_count());
+  if (is_verified(b)) {
+    return;
+  }
+  const size_t block_items = static_cast<size_t>(header.block_items);
+  const size_t first = b * block_items;
+  const size_t n = std::min(size(), first + block_items) - first;
+  if (crc32c(0, items + first, n * sizeof(T)) != crcs[b]) {
+    throw std::runtime_error("succinct: checksum mismatch");
+  }
+  // Two threads may both check a block; either one marks it.
+  verified[b / 64].fetch_or(static_cast<std::uint64_t>(1) << (b % 64),
+                            std::memory_order_release);
+}
+
+template<typename T>
+void
+mapped_vector<T>::start_scrub() {
+  assert (0 == scrubber);
+  scrubber = new std::thread([this]() {
+    for (size_t b = 0; (b < block_count()) and not stopping; ++b) {
+      try {
+        verify(b);
+      } catch (const std::runtime_error &) {
+        scrub_failed = true;
+      }
+    }
+  });
+}
+
+template<typename T>
+void
+mapped_vector<T>::finish_scrub() {
+  if (0 != scrubber) {
+    scrubber->join();
+    delete scrubber;
+    scrubber = 0;
+  }
+  if (scrub_failed) {
+    throw std::runtime_error("succinct: checksum mismatch");
+  }
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,209 @@
+/*
+Stable merges of sorted succinct vectors.
+
+merge(a, b) shapes the result for its final size up front, without
+initializing the items or reserving anything, and reads both inputs a
+buffer at a time through segment cursors, writing the merged items
+into place through a small staging area. With more than one thread,
+the output is split into equal ranges, and the items of a and b that
+go into each range are found by binary search along the merge path;
+each thread then merges its range into place.
+
+inplace_merge(a, b) grows a to its final size the same way and merges
+b into it from the back, so that no item of a is overwritten before it
+is read. Neither leaves a reservation behind. Both use O(\sqrt{n})
+space beyond the inputs and the output.
+
+ */
+
+#ifndef SUCCINCT_MERGE_HPP
+#define SUCCINCT_MERGE_HPP
+
+#include <cassert>
+#include <functional>
+
+#include "succinct_vector.hpp"
+#include "succinct_parallel.hpp"
+
+namespace succinct {
+
+// The number of items merged between writes to the output
+static const std::size_t merge_chunk = 256;
+
+// A read position in a vector that steps through the contiguous items
+// of each segment.
+template<typename T>
+struct segment_cursor {
+  typedef std::size_t size_t;
+  const vector<T> & v;
+  size_t index;
+  const T * item;
+  const T * segment_end;
+
+  segment_cursor(const vector<T> & that, const size_t i) :
+    v(that), index(i), item(0), segment_end(0)
+  {
+    seek(i);
+  }
+
+  void
+  seek(const size_t i) {
+    index = i;
+    if (i >= v.size()) {
+      item = segment_end = 0;
+      return;
+    }
+    const size_t cap = v.segment_capacity();
+    const size_t k = i / cap;
+    item = v.segment(k) + (i & (cap - 1));
+    segment_end = v.segment(k) + v.segment_size(k);
+  }
+
+  void
+  advance() {
+    ++index;
+    if (++item == segment_end) {
+      seek(index);
+    }
+  }
+};
+
+// Merge a[a_first, a_last) and b[b_first, b_last), calling
+// flush(items, n) on each run of merged items. Ties go to a.
+template<typename T, typename Compare, typename Flush>
+void
+merge_ranges(const vector<T> & a, const std::size_t a_first,
+             const std::size_t a_last, const vector<T> & b,
+             const std::size_t b_first, const std::size_t b_last,
+             Compare comp, Flush flush) {
+  T staging[merge_chunk];
+  std::size_t n = 0;
+  segment_cursor<T> x(a, a_first);
+  segment_cursor<T> y(b, b_first);
+  while ((x.index < a_last) and (y.index < b_last)) {
+    if (comp(*y.item, *x.item)) {
+      staging[n] = *y.item;
+      y.advance();
+    } else {
+      staging[n] = *x.item;
+      x.advance();
+    }
+    if (++n == merge_chunk) {
+      flush(static_cast<const T *>(staging), n);
+      n = 0;
+    }
+  }
+  for (; x.index < a_last; x.advance()) {
+    staging[n] = *x.item;
+    if (++n == merge_chunk) {
+      flush(static_cast<const T *>(staging), n);
+      n = 0;
+    }
+  }
+  for (; y.index < b_last; y.advance()) {
+    staging[n] = *y.item;
+    if (++n == merge_chunk) {
+      flush(static_cast<const T *>(staging), n);
+      n = 0;
+    }
+  }
+  flush(static_cast<const T *>(staging), n);
+}
+
+// The number of items of a among the first d items of the merge of a
+// and b. O(\log n).
+template<typename T, typename Compare>
+std::size_t
+merge_path(const vector<T> & a, const vector<T> & b, const std::size_t d,
+           Compare comp) {
+  std::size_t lo = (d > b.size()) ? (d - b.size()) : 0;
+  std::size_t hi = std::min(d, a.size());
+  while (lo < hi) {
+    const std::size_t mid = lo + (hi - lo) / 2;
+    if (comp(b[d - mid - 1], a[mid])) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+// The sorted items of a and b, which must be sorted by comp. Items of
+// a come before equal items of b. The result has the smallest shape
+// for its size and no reservation. Θ(n / threads + threads * \log n).
+template<typename T, typename Compare>
+vector<T>
+merge(const vector<T> & a, const vector<T> & b, Compare comp,
+      const unsigned threads = 0) {
+  const std::size_t total = a.size() + b.size();
+  vector<T> result;
+  vector_access::shape_for_overwrite(result, total);
+  const unsigned t_count = thread_count(threads, total / merge_chunk);
+  const std::size_t cap = result.segment_capacity();
+  parallel_ranges(total, t_count,
+    [&](unsigned, const std::size_t first, const std::size_t last) {
+      const std::size_t a_first = merge_path(a, b, first, comp);
+      const std::size_t a_last = merge_path(a, b, last, comp);
+      std::size_t to = first;
+      merge_ranges(a, a_first, a_last, b, first - a_first, last - a_last, comp,
+        [&](const T * items, std::size_t n) {
+          while (n > 0) {
+            const std::size_t offset = to & (cap - 1);
+            const std::size_t len = std::min(cap - offset, n);
+            std::copy(items, items + len, result.segment(to / cap) + offset);
+            items += len;
+            n -= len;
+            to += len;
+          }
+        });
+      assert (to == last);
+    });
+  return result;
+}
+
+template<typename T>
+vector<T>
+merge(const vector<T> & a, const vector<T> & b) {
+  return merge(a, b, std::less<T>());
+}
+
+// Merge b into a, both sorted by comp. Items of a come before equal
+// items of b. a's reservation, if any, is unchanged.
+// Θ(a.size() + b.size()).
+template<typename T, typename Compare>
+void
+inplace_merge(vector<T> & a, const vector<T> & b, Compare comp) {
+  std::size_t i = a.size();
+  std::size_t j = b.size();
+  vector_access::grow_for_overwrite(a, i + j);
+  const vector<T> & items = a;
+  const std::size_t cap = a.segment_capacity();
+  // Fill a from the back a segment at a time. Since at most i items
+  // of a are still to be placed, the write position never passes the
+  // read position.
+  std::size_t to = i + j;
+  while (j > 0) {
+    T * const out = a.segment((to - 1) / cap);
+    std::size_t k = ((to - 1) & (cap - 1)) + 1;
+    for (; (k > 0) and (j > 0); --k) {
+      if ((i > 0) and comp(b[j-1], items[i-1])) {
+        out[k-1] = items[--i];
+      } else {
+        out[k-1] = b[--j];
+      }
+    }
+    to -= ((to - 1) & (cap - 1)) + 1 - k;
+  }
+  // The remaining items of a are already in place
+  assert (to == i);
+}
+
+template<typename T>
+void
+inplace_merge(vector<T> & a, const vector<T> & b) {
+  inplace_merge(a, b, std::less<T>());
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,387 @@
+/*
+A lock-free multi-producer, multi-consumer FIFO queue whose storage is
+a chain of segments that grows and shrinks with the queue.
+
+Producers and consumers claim slots by fetch_add on the push and pop
+indexes of the segment at the tail or the head of the chain. Each slot
+has a state: empty, full, or taken. A producer writes its item into the
+slot it claimed and then moves the slot from empty to full; a consumer
+moves the slot it claimed to taken, and gets an item only if the slot
+was full. A consumer that gets to a slot before its producer has
+filled it leaves it taken, and the producer claims another slot. So
+neither side ever waits for the other, and a consumer on an empty
+queue returns at once.
+
+A producer that claims a slot past the end of the tail segment links
+a new segment after it, with its own item already in the first slot.
+A consumer that claims a slot past the end of the head segment, which
+has then been drained, moves the head (and, if it lags, the tail) past
+it and retires it. New segments have room for about \sqrt{n} items,
+where n is the length of the queue, so the chain has O(\sqrt{n})
+segments, and the space beyond the items is O(\sqrt{n}) plus the
+slots left taken by consumers that got there early.
+
+A retired segment may still be in use by a thread that read the head
+or the tail before it moved, so it is only freed once no hazard
+pointer names it. Each push or pop publishes the segment it works in
+as its hazard pointer, in a record it takes from a shared list for the
+length of the call. Once the retired segments outnumber twice the
+records, the thread that retires one checks them all against the
+hazard pointers and frees those that are not named, except that one
+is kept as a spare for the next new segment of the same size.
+
+Items must be default-constructible and copy-assignable.
+
+ */
+
+#ifndef SUCCINCT_MPMC_QUEUE_HPP
+#define SUCCINCT_MPMC_QUEUE_HPP
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace succinct {
+
+template<typename T>
+struct mpmc_queue {
+public:
+  typedef std::size_t size_t;
+  // Segments hold at least min_segment_capacity items, which must be
+  // a power of 2.
+  explicit mpmc_queue(const size_t min_segment_capacity = 64);
+  mpmc_queue(const mpmc_queue &) = delete;
+  mpmc_queue & operator=(const mpmc_queue &) = delete;
+  ~mpmc_queue();
+  // Add an item. Lock-free. O(1) amortized, Θ(\sqrt{n}) when it
+  // links a new segment.
+  void push(const T &);
+  // Remove the oldest item, returning false if the queue is empty.
+  // Lock-free. O(1) amortized.
+  bool try_pop(T &);
+  // The number of segments allocated, and of slots in them, including
+  // retired segments not yet freed and the spare
+  size_t allocated_segments() const;
+  size_t allocated_slots() const;
+
+protected:
+  enum slot_state { empty = 0, full = 1, taken = 2 };
+
+  struct slot {
+    std::atomic<unsigned char> state;
+    T value;
+  };
+
+  struct segment {
+    // The number of slots in the segments before this one
+    size_t first;
+    size_t capacity;
+    slot * slots;
+    std::atomic<size_t> push_index;
+    // Keep producers and consumers off each other's cache line.
+    char padding[64];
+    std::atomic<size_t> pop_index;
+    std::atomic<segment *> next;
+    // The next segment waiting to be freed
+    segment * retired_next;
+  };
+
+  struct hazard {
+    std::atomic<bool> active;
+    std::atomic<segment *> pointer;
+    hazard * next;
+  };
+
+  const size_t min_capacity;
+
+  alignas(64) std::atomic<segment *> tail;
+  alignas(64) std::atomic<segment *> head;
+  // first + capacity of the last segment drained
+  std::atomic<size_t> drained;
+
+  alignas(64) std::atomic<hazard *> hazards;
+  std::atomic<size_t> hazard_count;
+  std::atomic<segment *> retired;
+  std::atomic<size_t> retired_count;
+  std::atomic<segment *> spare;
+  std::atomic<size_t> segment_count;
+  std::atomic<size_t> slot_count;
+
+  // A segment after the given number of slots, sized for the current
+  // length of the queue
+  segment *
+  make_segment(const size_t first) {
+    const size_t length = first - drained.load();
+    size_t capacity = min_capacity;
+    while (capacity * capacity < length) {
+      capacity *= 2;
+    }
+    segment * result = spare.exchange(0);
+    if ((0 != result) and (result->capacity != capacity)) {
+      destroy(result);
+      result = 0;
+    }
+    if (0 == result) {
+      result = new segment;
+      result->capacity = capacity;
+      result->slots = new slot[capacity];
+      segment_count.fetch_add(1);
+      slot_count.fetch_add(capacity);
+    }
+    result->first = first;
+    for (size_t j = 0; j < capacity; ++j) {
+      result->slots[j].state.store(empty, std::memory_order_relaxed);
+    }
+    result->push_index.store(0, std::memory_order_relaxed);
+    result->pop_index.store(0, std::memory_order_relaxed);
+    result->next.store(0, std::memory_order_relaxed);
+    result->retired_next = 0;
+    return result;
+  }
+
+  void
+  destroy(segment * const s) {
+    segment_count.fetch_sub(1);
+    slot_count.fetch_sub(s->capacity);
+    delete[] s->slots;
+    delete s;
+  }
+
+  // Keep a segment that no thread can reach as the spare, freeing the
+  // spare it replaces.
+  void
+  recycle(segment * const s) {
+    segment * const old = spare.exchange(s);
+    if (0 != old) {
+      destroy(old);
+    }
+  }
+
+  // Take an unused hazard record, adding one if they are all in use.
+  hazard *
+  acquire() {
+    for (hazard * h = hazards.load(); 0 != h; h = h->next) {
+      if ((not h->active.load(std::memory_order_relaxed))
+          and (not h->active.exchange(true))) {
+        return h;
+      }
+    }
+    hazard * const h = new hazard;
+    h->active.store(true, std::memory_order_relaxed);
+    h->pointer.store(0, std::memory_order_relaxed);
+    hazard * old = hazards.load();
+    do {
+      h->next = old;
+    } while (not hazards.compare_exchange_weak(old, h));
+    hazard_count.fetch_add(1);
+    return h;
+  }
+
+  static void
+  release(hazard * const h) {
+    h->pointer.store(0, std::memory_order_release);
+    h->active.store(false, std::memory_order_release);
+  }
+
+  // The segment source points to, named by h so that it is not freed
+  static segment *
+  protect(const std::atomic<segment *> & source, hazard * const h) {
+    segment * s = source.load();
+    for (;;) {
+      h->pointer.store(s);
+      segment * const again = source.load();
+      if (again == s) {
+        return s;
+      }
+      s = again;
+    }
+  }
+
+  // Add s, which no longer is the head or the tail, to the retired
+  // segments. Returns how many there are.
+  size_t
+  add_retired(segment * const s) {
+    segment * old = retired.load();
+    do {
+      s->retired_next = old;
+    } while (not retired.compare_exchange_weak(old, s));
+    return retired_count.fetch_add(1) + 1;
+  }
+
+  bool
+  named(const segment * const s) const {
+    for (hazard * h = hazards.load(); 0 != h; h = h->next) {
+      if (h->pointer.load() == s) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void
+  retire(segment * const s) {
+    if (add_retired(s) <= 2 * hazard_count.load()) {
+      return;
+    }
+    // Free every retired segment that no hazard pointer names, and put
+    // the others back.
+    segment * r = retired.exchange(0);
+    while (0 != r) {
+      segment * const after = r->retired_next;
+      retired_count.fetch_sub(1);
+      if (named(r)) {
+        add_retired(r);
+      } else {
+        recycle(r);
+      }
+      r = after;
+    }
+  }
+
+  void
+  note_drained(const size_t slots) {
+    size_t old = drained.load();
+    while ((old < slots) and not drained.compare_exchange_weak(old, slots)) {
+    }
+  }
+
+}; // struct mpmc_queue
+
+template<typename T>
+mpmc_queue<T>::mpmc_queue(const size_t min_segment_capacity) :
+  min_capacity(min_segment_capacity),
+  tail(0),
+  head(0),
+  drained(0),
+  hazards(0),
+  hazard_count(0),
+  retired(0),
+  retired_count(0),
+  spare(0),
+  segment_count(0),
+  slot_count(0)
+{
+  assert ((min_capacity > 0) and (0 == (min_capacity & (min_capacity - 1))));
+  segment * const s = make_segment(0);
+  tail.store(s);
+  head.store(s);
+}
+
+template<typename T>
+mpmc_queue<T>::~mpmc_queue() {
+  for (segment * s = head.load(); 0 != s; ) {
+    segment * const after = s->next.load();
+    destroy(s);
+    s = after;
+  }
+  for (segment * s = retired.load(); 0 != s; ) {
+    segment * const after = s->retired_next;
+    destroy(s);
+    s = after;
+  }
+  if (0 != spare.load()) {
+    destroy(spare.load());
+  }
+  for (hazard * h = hazards.load(); 0 != h; ) {
+    hazard * const after = h->next;
+    delete h;
+    h = after;
+  }
+}
+
+template<typename T>
+void
+mpmc_queue<T>::push(const T & x) {
+  hazard * const h = acquire();
+  for (;;) {
+    segment * const s = protect(tail, h);
+    const size_t i = s->push_index.fetch_add(1);
+    if (i < s->capacity) {
+      slot & to = s->slots[i];
+      to.value = x;
+      unsigned char expected = empty;
+      if (to.state.compare_exchange_strong(expected, full,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        break;
+      }
+      // A consumer got here first and gave up on this slot.
+      continue;
+    }
+    segment * next = s->next.load();
+    if (0 == next) {
+      segment * const fresh = make_segment(s->first + s->capacity);
+      fresh->slots[0].value = x;
+      fresh->slots[0].state.store(full, std::memory_order_relaxed);
+      fresh->push_index.store(1, std::memory_order_relaxed);
+      if (s->next.compare_exchange_strong(next, fresh)) {
+        segment * expected = s;
+        tail.compare_exchange_strong(expected, fresh);
+        break;
+      }
+      // Another producer linked one first; no other thread has seen
+      // this one.
+      recycle(fresh);
+    }
+    // Help move the tail along.
+    segment * expected = s;
+    tail.compare_exchange_strong(expected, next);
+  }
+  release(h);
+}
+
+template<typename T>
+bool
+mpmc_queue<T>::try_pop(T & x) {
+  hazard * const h = acquire();
+  for (;;) {
+    segment * const s = protect(head, h);
+    const size_t claimed = s->pop_index.load();
+    if (((claimed >= s->push_index.load()) or (claimed >= s->capacity))
+        and (0 == s->next.load())) {
+      release(h);
+      return false;
+    }
+    const size_t i = s->pop_index.fetch_add(1);
+    if (i < s->capacity) {
+      slot & from = s->slots[i];
+      if (full == from.state.exchange(taken, std::memory_order_acquire)) {
+        x = from.value;
+        release(h);
+        return true;
+      }
+      // The producer has not filled this slot; it will claim another.
+      continue;
+    }
+    segment * const next = s->next.load();
+    if (0 == next) {
+      release(h);
+      return false;
+    }
+    // s is drained. The tail may not stay behind the head.
+    segment * expected = s;
+    tail.compare_exchange_strong(expected, next);
+    expected = s;
+    if (head.compare_exchange_strong(expected, next)) {
+      note_drained(s->first + s->capacity);
+      h->pointer.store(0);
+      retire(s);
+    }
+  }
+}
+
+template<typename T>
+size_t
+mpmc_queue<T>::allocated_segments() const {
+  return segment_count.load();
+}
+
+template<typename T>
+size_t
+mpmc_queue<T>::allocated_slots() const {
+  return slot_count.load();
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,266 @@
+/*
+Saving succinct vectors as NumPy .npy files and loading them back.
+
+A .npy file is a short header, describing the item type and the shape
+of the array as a Python dict literal, followed by the items in order.
+save_npy writes the header and then every buffer with writev, a
+thousand or so buffers per system call, so the items are never copied
+into a staging area. load_npy reads the header, shapes the vector for
+the number of items first, and then reads straight into its buffers
+with readv. Either way, peak memory is the vector itself.
+
+Vectors are saved as one-dimensional arrays. Arrays of any shape can
+be loaded, in C order, as long as the item type matches T exactly;
+Fortran-order arrays with more than one dimension cannot.
+
+Items must be trivially copyable, since they are written as bytes.
+This uses POSIX I/O, and throws std::runtime_error if it fails or the
+file is not a .npy file with the right item type. A truncated file is
+only noticed after the vector has been replaced.
+
+ */
+
+#ifndef SUCCINCT_NPY_HPP
+#define SUCCINCT_NPY_HPP
+
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+// The NumPy type description of T, such as "<f8"
+template<typename T>
+std::string
+npy_descr() {
+  static_assert(std::is_arithmetic<T>::value, ".npy files hold numbers");
+  std::string result;
+  if (1 == sizeof(T)) {
+    result += '|';
+  } else {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    result += '>';
+#else
+    result += '<';
+#endif
+  }
+  if (std::is_same<T, bool>::value) {
+    result += 'b';
+  } else if (std::is_floating_point<T>::value) {
+    result += 'f';
+  } else {
+    result += std::is_signed<T>::value ? 'i' : 'u';
+  }
+  result += std::to_string(sizeof(T));
+  return result;
+}
+
+// Read or write all the pieces, in order, IOV_MAX at a time. Short
+// transfers are resumed where they stopped. Returns false on failure
+// or if the file ends first.
+inline bool
+transfer_vectored(const int fd, const bool write, const vector<iovec> & pieces) {
+  iovec batch[IOV_MAX];
+  std::size_t next = 0;
+  int count = 0;
+  int first = 0;
+  for (;;) {
+    // Refill the batch once it is used up.
+    if (first == count) {
+      count = 0;
+      first = 0;
+      for (; (next < pieces.size()) and (count < IOV_MAX); ++next) {
+        if (0 != pieces[next].iov_len) {
+          batch[count++] = pieces[next];
+        }
+      }
+      if (0 == count) {
+        return true;
+      }
+    }
+    const ssize_t done = write ? ::writev(fd, batch + first, count - first)
+                               : ::readv(fd, batch + first, count - first);
+    if ((done < 0) and (EINTR == errno)) {
+      continue;
+    }
+    if (done <= 0) {
+      return false;
+    }
+    std::size_t left = static_cast<std::size_t>(done);
+    while ((first < count) and (left >= batch[first].iov_len)) {
+      left -= batch[first].iov_len;
+      ++first;
+    }
+    if (left > 0) {
+      batch[first].iov_base = static_cast<unsigned char *>(batch[first].iov_base) + left;
+      batch[first].iov_len -= left;
+    }
+  }
+}
+
+// The value of key in the header dict, starting after the colon and
+// any spaces
+inline std::size_t
+npy_field(const std::string & header, const char * const key) {
+  std::size_t at = header.find(std::string("'") + key + "'");
+  if (std::string::npos == at) {
+    throw std::runtime_error("succinct: .npy header is missing a field");
+  }
+  at = header.find(':', at);
+  if (std::string::npos == at) {
+    throw std::runtime_error("succinct: .npy header is malformed");
+  }
+  at = header.find_first_not_of(' ', at + 1);
+  if (std::string::npos == at) {
+    throw std::runtime_error("succinct: .npy header is malformed");
+  }
+  return at;
+}
+
+// Write v to the file at path as a one-dimensional .npy array,
+// replacing it. Θ(n).
+template<typename T>
+void
+save_npy(const vector<T> & v, const char * const path) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "save_npy writes items as bytes");
+  std::string dict = "{'descr': '" + npy_descr<T>() + "', 'fortran_order': False, "
+    "'shape': (" + std::to_string(v.size()) + ",), }";
+  // The magic string, version and header length take 10 bytes. The
+  // dict is padded with spaces and a newline to a multiple of 64.
+  const std::size_t padded = (10 + dict.size() + 1 + 63) / 64 * 64;
+  dict.append(padded - 10 - dict.size() - 1, ' ');
+  dict += '\n';
+  std::string header("\x93NUMPY\x01\x00", 8);
+  header += static_cast<char>(dict.size() & 0xff);
+  header += static_cast<char>(dict.size() >> 8);
+  header += dict;
+
+  vector<iovec> pieces;
+  iovec piece;
+  piece.iov_base = const_cast<char *>(header.data());
+  piece.iov_len = header.size();
+  pieces.push_back(piece);
+  for (std::size_t k = 0; k < v.segment_count(); ++k) {
+    // writev only reads from the segments.
+    piece.iov_base = const_cast<T *>(v.segment(k));
+    piece.iov_len = v.segment_size(k) * sizeof(T);
+    pieces.push_back(piece);
+  }
+  const int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    throw std::runtime_error("succinct: cannot open file");
+  }
+  const bool written = transfer_vectored(fd, true, pieces);
+  ::close(fd);
+  if (not written) {
+    throw std::runtime_error("succinct: cannot write file");
+  }
+}
+
+// Replace the items of v with those of the .npy array in the file at
+// path, which must hold items of type T. v takes the smallest shape
+// for its new size, with no reservation. If the header is bad, v is
+// unchanged; if the file is truncated, v has already been replaced
+// and holds what was read, with the rest of its items indeterminate.
+// Θ(n).
+template<typename T>
+void
+load_npy(vector<T> & v, const char * const path) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "load_npy reads items as bytes");
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("succinct: cannot open file");
+  }
+  try {
+    // The magic string, the version and the header length, which is
+    // 2 bytes in version 1 and 4 bytes after that
+    unsigned char prefix[12];
+    vector<iovec> pieces;
+    iovec piece;
+    piece.iov_base = prefix;
+    piece.iov_len = 10;
+    pieces.push_back(piece);
+    if (not transfer_vectored(fd, false, pieces)
+        or (0 != std::memcmp(prefix, "\x93NUMPY", 6))) {
+      throw std::runtime_error("succinct: not a .npy file");
+    }
+    std::size_t length = prefix[8] | (static_cast<std::size_t>(prefix[9]) << 8);
+    if (prefix[6] >= 2) {
+      pieces[0].iov_base = prefix + 10;
+      pieces[0].iov_len = 2;
+      if (not transfer_vectored(fd, false, pieces)) {
+        throw std::runtime_error("succinct: not a .npy file");
+      }
+      length |= (static_cast<std::size_t>(prefix[10]) << 16)
+        | (static_cast<std::size_t>(prefix[11]) << 24);
+    }
+    std::string header(length, ' ');
+    pieces[0].iov_base = &header[0];
+    pieces[0].iov_len = length;
+    if (not transfer_vectored(fd, false, pieces)) {
+      throw std::runtime_error("succinct: .npy header is truncated");
+    }
+
+    const std::size_t descr = npy_field(header, "descr");
+    const std::string expected = "'" + npy_descr<T>() + "'";
+    if (0 != header.compare(descr, expected.size(), expected)) {
+      throw std::runtime_error("succinct: .npy file has the wrong item type");
+    }
+    const bool fortran = (0 == header.compare(npy_field(header, "fortran_order"), 4, "True"));
+    std::size_t at = npy_field(header, "shape");
+    if ('(' != header[at]) {
+      throw std::runtime_error("succinct: .npy header is malformed");
+    }
+    // The product of the dimensions
+    std::size_t size = 1;
+    std::size_t dimensions = 0;
+    for (++at; (at < header.size()) and (')' != header[at]); ) {
+      if ((',' == header[at]) or (' ' == header[at])) {
+        ++at;
+        continue;
+      }
+      char * end;
+      const unsigned long long d = std::strtoull(header.c_str() + at, &end, 10);
+      if (end == header.c_str() + at) {
+        throw std::runtime_error("succinct: .npy header is malformed");
+      }
+      at = static_cast<std::size_t>(end - header.c_str());
+      size *= static_cast<std::size_t>(d);
+      ++dimensions;
+    }
+    if (fortran and (dimensions > 1)) {
+      throw std::runtime_error("succinct: cannot load a Fortran-order .npy file");
+    }
+
+    // readv fills every item, so the buffers are not initialized.
+    vector_access::shape_for_overwrite(v, size);
+    pieces.resize(0);
+    for (std::size_t k = 0; k < v.segment_count(); ++k) {
+      piece.iov_base = v.segment(k);
+      piece.iov_len = v.segment_size(k) * sizeof(T);
+      pieces.push_back(piece);
+    }
+    if (not transfer_vectored(fd, false, pieces)) {
+      throw std::runtime_error("succinct: .npy file is truncated");
+    }
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,62 @@
+/*
+Running work on several threads, split into contiguous ranges.
+
+ */
+
+#ifndef SUCCINCT_PARALLEL_HPP
+#define SUCCINCT_PARALLEL_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+// The number of threads to use for count units of work, given the
+// number asked for. threads == 0 means one per hardware thread.
+inline unsigned
+thread_count(unsigned threads, const std::size_t count) {
+  if (0 == threads) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  if (threads > count) {
+    threads = static_cast<unsigned>(std::max(static_cast<std::size_t>(1), count));
+  }
+  return threads;
+}
+
+// Split [0, count) into threads contiguous ranges and call f(t, first,
+// last) for the tth range on its own thread. The calling thread runs
+// the first range.
+template<typename Function>
+void
+parallel_ranges(const std::size_t count, const unsigned threads, Function f) {
+  assert (threads > 0);
+  vector<std::thread *> workers;
+  for (unsigned t = 1; t < threads; ++t) {
+    workers.push_back(new std::thread(f, t, count * t / threads,
+                                      count * (t + 1) / threads));
+  }
+  f(0u, static_cast<std::size_t>(0), count / threads);
+  for (std::size_t t = 0; t < workers.size(); ++t) {
+    workers[t]->join();
+    delete workers[t];
+  }
+}
+
+// The segments of v, for writing to from several threads. Fetching
+// them up front means the threads never touch the cached hashes.
+template<typename T>
+vector<T *>
+segment_pointers(vector<T> & v) {
+  vector<T *> result;
+  for (std::size_t k = 0; k < v.segment_count(); ++k) {
+    result.push_back(v.segment(k));
+  }
+  return result;
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,272 @@
+/*
+LSD radix sort of succinct vectors of integer and floating-point keys,
+optionally carrying a vector of values along (the keys and values
+being a structure of arrays).
+
+Keys are mapped to unsigned integers with the same order and sorted a
+byte at a time, from the least significant. Each pass counts the
+digits of each thread's range of items, buffer by buffer, and then
+each thread scatters its items to their place in a scratch vector,
+which is itself a succinct vector; the next pass scatters back. Bytes
+that are the same in every key are skipped, so sorting small keys
+stored in wide types does not pay for the high bytes.
+
+The sort is stable. The scratch space is n + O(\sqrt{n}) items, plus
+O(threads) digit counts.
+
+ */
+
+#ifndef SUCCINCT_RADIX_SORT_HPP
+#define SUCCINCT_RADIX_SORT_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <cassert>
+
+#include "succinct_vector.hpp"
+#include "succinct_parallel.hpp"
+#include "succinct_aggregate.hpp"
+
+namespace succinct {
+
+// The number of items per thread below which more threads do not help
+static const std::size_t radix_grain = 1 << 16;
+
+// radix_traits<T>::key(x) is an unsigned integer ordered like x.
+template<typename T>
+struct radix_traits;
+
+template<>
+struct radix_traits<std::uint32_t> {
+  typedef std::uint32_t key_type;
+  static key_type key(const std::uint32_t x) { return x; }
+};
+
+template<>
+struct radix_traits<std::uint64_t> {
+  typedef std::uint64_t key_type;
+  static key_type key(const std::uint64_t x) { return x; }
+};
+
+template<>
+struct radix_traits<std::int32_t> {
+  typedef std::uint32_t key_type;
+  static key_type
+  key(const std::int32_t x) {
+    return static_cast<key_type>(x) ^ (static_cast<key_type>(1) << 31);
+  }
+};
+
+template<>
+struct radix_traits<std::int64_t> {
+  typedef std::uint64_t key_type;
+  static key_type
+  key(const std::int64_t x) {
+    return static_cast<key_type>(x) ^ (static_cast<key_type>(1) << 63);
+  }
+};
+
+// Negative numbers have their bits flipped, so that larger
+// magnitudes come first; positive numbers have the sign bit set, so
+// they come after. -0.0 comes before 0.0, and NaNs with the sign bit
+// clear come last.
+template<>
+struct radix_traits<float> {
+  typedef std::uint32_t key_type;
+  static key_type
+  key(const float x) {
+    key_type bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return (bits >> 31) ? ~bits : (bits | (static_cast<key_type>(1) << 31));
+  }
+};
+
+template<>
+struct radix_traits<double> {
+  typedef std::uint64_t key_type;
+  static key_type
+  key(const double x) {
+    key_type bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return (bits >> 63) ? ~bits : (bits | (static_cast<key_type>(1) << 63));
+  }
+};
+
+// The digit of x for the given pass
+template<typename K>
+inline std::size_t
+radix_digit(const K & x, const unsigned pass) {
+  return static_cast<std::size_t>(
+    (radix_traits<K>::key(x) >> (8 * pass)) & 255);
+}
+
+// Copy the items of from into to, which has the same size.
+template<typename T>
+void
+copy_items(const vector<T> & from, vector<T> & to) {
+  assert (from.size() == to.size());
+  const std::size_t cap = to.segment_capacity();
+  std::size_t i = 0;
+  for_each_chunk(from, 0, from.size(), [&](const T * const x, std::size_t n) {
+    for (const T * p = x; n > 0; ) {
+      const std::size_t offset = i & (cap - 1);
+      const std::size_t len = std::min(cap - offset, n);
+      std::copy(p, p + len, to.segment(i / cap) + offset);
+      p += len;
+      n -= len;
+      i += len;
+    }
+  });
+}
+
+// Call place(i, keys[i], to) for each i in [first, last), where to is
+// where the item goes in the given pass. offsets holds the position of
+// the next item with each digit, and is updated.
+template<typename K, typename Place>
+void
+radix_scatter(const vector<K> & keys, const std::size_t first,
+              const std::size_t last, const unsigned pass,
+              std::size_t * const offsets, Place place) {
+  std::size_t i = first;
+  for_each_chunk(keys, first, last, [&](const K * const x, const std::size_t n) {
+    for (std::size_t j = 0; j < n; ++j, ++i) {
+      place(i, x[j], offsets[radix_digit(x[j], pass)]++);
+    }
+  });
+}
+
+// Sort keys, and values along with them if there are any (that is,
+// if values is not null).
+template<typename K, typename V>
+void
+radix_sort_with(vector<K> & keys, vector<V> * const values,
+                const unsigned threads) {
+  typedef typename radix_traits<K>::key_type key_type;
+  const unsigned passes = sizeof(key_type);
+  const std::size_t n = keys.size();
+  assert ((0 == values) or (values->size() == n));
+  const unsigned t_count = thread_count(threads, n / radix_grain);
+
+  // Find the passes that move anything: those in which not every key
+  // has the same digit.
+  std::size_t all_counts[sizeof(key_type) * 256] = {};
+  for_each_chunk(keys, 0, n, [&](const K * const x, const std::size_t m) {
+    for (std::size_t j = 0; j < m; ++j) {
+      const key_type k = radix_traits<K>::key(x[j]);
+      for (unsigned pass = 0; pass < passes; ++pass) {
+        ++all_counts[pass * 256 + ((k >> (8 * pass)) & 255)];
+      }
+    }
+  });
+  vector<unsigned> needed;
+  for (unsigned pass = 0; pass < passes; ++pass) {
+    const std::size_t * const counts = all_counts + pass * 256;
+    if (n != *std::max_element(counts, counts + 256)) {
+      needed.push_back(pass);
+    }
+  }
+  if (0 == needed.size()) {
+    return;
+  }
+
+  // The first scatter overwrites every item, so the scratch vectors
+  // are only shaped, not filled.
+  vector<K> key_scratch;
+  vector_access::shape_for_overwrite(key_scratch, n);
+  vector<V> value_scratch;
+  if (0 != values) {
+    vector_access::shape_for_overwrite(value_scratch, n);
+  }
+  vector<K> * key_from = &keys;
+  vector<K> * key_to = &key_scratch;
+  vector<V> * value_from = values;
+  vector<V> * value_to = &value_scratch;
+  // offsets[t * 256 + d] is where thread t puts its next item with
+  // digit d.
+  std::size_t * const offsets = new std::size_t[t_count * 256];
+
+  for (std::size_t p = 0; p < needed.size(); ++p) {
+    const unsigned pass = needed[p];
+    if (1 == t_count) {
+      std::copy(all_counts + pass * 256, all_counts + pass * 256 + 256, offsets);
+    } else {
+      parallel_ranges(n, t_count,
+        [&](const unsigned t, const std::size_t first, const std::size_t last) {
+          std::size_t * const counts = offsets + t * 256;
+          std::fill(counts, counts + 256, 0);
+          for_each_chunk(*key_from, first, last,
+            [&](const K * const x, const std::size_t m) {
+              for (std::size_t j = 0; j < m; ++j) {
+                ++counts[radix_digit(x[j], pass)];
+              }
+            });
+        });
+    }
+    // Turn the counts into starting positions, ordered by digit and
+    // then by thread, which keeps the sort stable.
+    std::size_t total = 0;
+    for (std::size_t d = 0; d < 256; ++d) {
+      for (unsigned t = 0; t < t_count; ++t) {
+        const std::size_t count = offsets[t * 256 + d];
+        offsets[t * 256 + d] = total;
+        total += count;
+      }
+    }
+    assert (total == n);
+
+    const std::size_t cap = key_to->segment_capacity();
+    const unsigned log_cap = static_cast<unsigned>(__builtin_ctzll(cap));
+    const vector<K *> key_out = segment_pointers(*key_to);
+    vector<V *> value_out;
+    if (0 != values) {
+      value_out = segment_pointers(*value_to);
+    }
+    const vector<K> & key_in = *key_from;
+    const vector<V> * const value_in = value_from;
+    parallel_ranges(n, t_count,
+      [&](const unsigned t, const std::size_t first, const std::size_t last) {
+        if (0 == values) {
+          radix_scatter(key_in, first, last, pass, offsets + t * 256,
+            [&](std::size_t, const K & x, const std::size_t to) {
+              key_out[to >> log_cap][to & (cap - 1)] = x;
+            });
+        } else {
+          radix_scatter(key_in, first, last, pass, offsets + t * 256,
+            [&](const std::size_t i, const K & x, const std::size_t to) {
+              key_out[to >> log_cap][to & (cap - 1)] = x;
+              value_out[to >> log_cap][to & (cap - 1)] = (*value_in)[i];
+            });
+        }
+      });
+    std::swap(key_from, key_to);
+    std::swap(value_from, value_to);
+  }
+  delete[] offsets;
+
+  if (key_from != &keys) {
+    copy_items(*key_from, keys);
+    if (0 != values) {
+      copy_items(*value_from, *values);
+    }
+  }
+}
+
+// Sort v, whose items are 32- or 64-bit integers, floats or doubles.
+// Θ(n * sizeof(T) / threads).
+template<typename T>
+void
+radix_sort(vector<T> & v, const unsigned threads = 0) {
+  radix_sort_with(v, static_cast<vector<unsigned char> *>(0), threads);
+}
+
+// Sort keys as above, reordering values in the same way. keys and
+// values must be the same size. Items with equal keys keep their
+// order.
+template<typename K, typename V>
+void
+radix_sort(vector<K> & keys, vector<V> & values, const unsigned threads = 0) {
+  radix_sort_with(keys, &values, threads);
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,146 @@
+/*
+Parallel in-place prefix sums over a succinct vector.
+
+Since the buffers all have the same size (except the last one), they
+are split evenly among threads. The scan takes two passes over the
+items: each thread first reduces each of its buffers to a total, the
+O(\sqrt{n}) totals are scanned on one thread, and then each thread
+scans its buffers again, starting from the total of everything before
+them. op must be associative.
+
+ */
+
+#ifndef SUCCINCT_SCAN_HPP
+#define SUCCINCT_SCAN_HPP
+
+#include <cassert>
+#include <functional>
+
+#include "succinct_vector.hpp"
+#include "succinct_parallel.hpp"
+
+namespace succinct {
+
+// Run f(first, last) on ranges of segments of v, one range per thread.
+// threads == 0 means one per hardware thread.
+template<typename T, typename Function>
+void
+for_each_segment_range(const vector<T> & v, const unsigned threads, Function f) {
+  const std::size_t segments = v.segment_count();
+  parallel_ranges(segments, thread_count(threads, segments),
+    [&](unsigned, const std::size_t first, const std::size_t last) {
+      f(first, last);
+    });
+}
+
+// Scan v in place, with the total of the items before v (if any)
+// given by carry, which is updated to the total of all the items.
+template<typename T, typename BinaryOp>
+void
+scan_segments(vector<T> & v, const std::size_t first, const std::size_t last,
+              T & carry, bool & has_carry, const bool inclusive, BinaryOp op) {
+  for (std::size_t k = first; k < last; ++k) {
+    T * const x = v.segment(k);
+    const std::size_t m = v.segment_size(k);
+    std::size_t j = 0;
+    if (not has_carry) {
+      if (0 == m) {
+        continue;
+      }
+      // Only an inclusive scan with no initial value gets here.
+      assert (inclusive);
+      carry = x[0];
+      has_carry = true;
+      j = 1;
+    }
+    if (inclusive) {
+      for (; j < m; ++j) {
+        carry = op(carry, x[j]);
+        x[j] = carry;
+      }
+    } else {
+      for (; j < m; ++j) {
+        const T item = x[j];
+        x[j] = carry;
+        carry = op(carry, item);
+      }
+    }
+  }
+}
+
+template<typename T, typename BinaryOp>
+void
+parallel_scan(vector<T> & v, const bool inclusive, const T & init,
+              const bool has_init, BinaryOp op, const unsigned threads) {
+  const std::size_t segments = v.segment_count();
+  // The total of each segment, or nothing if it is empty
+  vector<T> totals;
+  totals.resize(segments);
+  for_each_segment_range(v, threads,
+    [&](const std::size_t first, const std::size_t last) {
+      for (std::size_t k = first; k < last; ++k) {
+        const T * const x = v.segment(k);
+        const std::size_t m = v.segment_size(k);
+        if (0 == m) {
+          continue;
+        }
+        T total = x[0];
+        for (std::size_t j = 1; j < m; ++j) {
+          total = op(total, x[j]);
+        }
+        totals[k] = total;
+      }
+    });
+  // Scan the totals, so that offsets[k] is the total before segment k.
+  // Only the last segment can be empty.
+  vector<T> offsets;
+  offsets.resize(segments);
+  T carry = init;
+  bool has_carry = has_init;
+  for (std::size_t k = 0; k < segments; ++k) {
+    offsets[k] = carry;
+    if (v.segment_size(k) > 0) {
+      carry = has_carry ? op(carry, totals[k]) : totals[k];
+      has_carry = true;
+    }
+  }
+  for_each_segment_range(v, threads,
+    [&](const std::size_t first, const std::size_t last) {
+      T segment_carry = offsets[first];
+      bool segment_has_carry = has_init or (first > 0);
+      scan_segments(v, first, last, segment_carry, segment_has_carry,
+                    inclusive, op);
+    });
+}
+
+// Replace each item by op applied to it and all the items before it.
+// Θ(n / threads + \sqrt{n}).
+template<typename T, typename BinaryOp>
+void
+inclusive_scan(vector<T> & v, BinaryOp op, const unsigned threads = 0) {
+  parallel_scan(v, true, T(), false, op, threads);
+}
+
+template<typename T>
+void
+inclusive_scan(vector<T> & v) {
+  inclusive_scan(v, std::plus<T>());
+}
+
+// Replace each item by op applied to init and all the items before it.
+// Θ(n / threads + \sqrt{n}).
+template<typename T, typename BinaryOp>
+void
+exclusive_scan(vector<T> & v, const T & init, BinaryOp op,
+               const unsigned threads = 0) {
+  parallel_scan(v, false, init, true, op, threads);
+}
+
+template<typename T>
+void
+exclusive_scan(vector<T> & v, const T & init = T()) {
+  exclusive_scan(v, init, std::plus<T>());
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,149 @@
+/*
+A succinct vector for index-addressed data, most of which is never
+written.
+
+This has the same shape as succinct::vector, but a buffer is only
+allocated when an item in it is written. Reading an item in a buffer
+that was never allocated returns a shared default value, so the space
+used is proportional to the number of buffers that have been written
+to, plus the O(\sqrt{n}) directory.
+
+ */
+
+#ifndef SUCCINCT_SPARSE_VECTOR_HPP
+#define SUCCINCT_SPARSE_VECTOR_HPP
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+template<typename T>
+struct sparse_vector : protected vector<T> {
+public:
+  typedef std::size_t size_t;
+  using vector<T>::size;
+  using vector<T>::capacity;
+  using vector<T>::reserve;
+  using vector<T>::shrink_to_fit;
+  // push_back allocates the last buffer if it is missing:
+  using vector<T>::push_back;
+  using vector<T>::pop_back;
+  // Reads never allocate. O(1).
+  const T & operator[](const size_t) const;
+  // Writes allocate the buffer holding the ith item if it is
+  // missing. O(\sqrt{n}) worst case, when a buffer is allocated. To
+  // read a non-const sparse_vector without allocating, use a const
+  // reference to it.
+  T & operator[](const size_t);
+  // Grow with default-valued items, without allocating any buffers
+  // for them, or shrink by discarding items from the end. Θ(size())
+  // worst case, if the shape must change, otherwise O(\sqrt{n}).
+  void resize(const size_t n);
+  // The number of buffers that have been allocated.
+  size_t allocated_buffers() const;
+
+protected:
+  typedef typename vector<T>::length_t length_t;
+
+  static const T &
+  default_value() {
+    static const T result = T();
+    return result;
+  }
+
+}; // struct sparse_vector
+
+template<typename T>
+const T &
+sparse_vector<T>::operator[](const size_t i) const {
+  this->assert_valid();
+  assert (i < size());
+  const T * const buffer = this->dir[i >> this->log_buffer_capacity];
+  if (0 == buffer) {
+    return default_value();
+  }
+  return buffer[i & (this->buffer_capacity() - 1)];
+}
+
+template<typename T>
+T &
+sparse_vector<T>::operator[](const size_t i) {
+  this->assert_valid();
+  assert (i < size());
+  T * & buffer = this->dir[i >> this->log_buffer_capacity];
+  if (0 == buffer) {
+    buffer = new T[this->buffer_capacity()]();
+  }
+  return buffer[i & (this->buffer_capacity() - 1)];
+}
+
+template<typename T>
+void
+sparse_vector<T>::resize(const size_t n) {
+  this->assert_valid();
+  const size_t old_size = size();
+  T ** const dir = this->dir;
+
+  // Extra buffers and the unused part of the last buffer may hold
+  // items left over from pop_back; those must not reappear.
+  if (this->extra_buffer) {
+    delete[] dir[this->dir_size];
+    dir[this->dir_size] = 0;
+    this->extra_buffer = false;
+  }
+
+  if (n < old_size) {
+    const length_t new_dir_size =
+      static_cast<length_t>(n >> this->log_buffer_capacity) + 1;
+    for (length_t i = new_dir_size; i < this->dir_size; ++i) {
+      delete[] dir[i];
+      dir[i] = 0;
+    }
+    this->dir_size = new_dir_size;
+    this->last_buffer_size =
+      static_cast<length_t>(n & (this->buffer_capacity() - 1));
+    // Rebuild to a smaller shape if the directory is now mostly
+    // empty. reshape() does not need the invariants to hold.
+    const length_t wanted =
+      std::max(vector<T>::log_capacity_for(n),
+               static_cast<length_t>(this->log_reserved));
+    if (wanted < this->log_capacity()) {
+      this->reshape(wanted);
+    }
+  } else if (n > old_size) {
+    T * const last_buffer = dir[this->dir_size-1];
+    if (0 != last_buffer) {
+      std::fill(last_buffer + this->last_buffer_size,
+                last_buffer + this->buffer_capacity(),
+                T());
+    }
+    const length_t wanted = vector<T>::log_capacity_for(n);
+    if (wanted > this->log_capacity()) {
+      this->reshape(wanted);
+    }
+    // The new directory entries are already null.
+    this->dir_size =
+      static_cast<length_t>(n >> this->log_buffer_capacity) + 1;
+    this->last_buffer_size =
+      static_cast<length_t>(n & (this->buffer_capacity() - 1));
+  }
+
+  this->assert_valid();
+  assert (size() == n);
+}
+
+template<typename T>
+size_t
+sparse_vector<T>::allocated_buffers() const {
+  const length_t end = this->dir_size + (this->extra_buffer ? 1 : 0);
+  size_t result = 0;
+  for (length_t i = 0; i < end; ++i) {
+    if (0 != this->dir[i]) {
+      ++result;
+    }
+  }
+  return result;
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,390 @@
+/*
+A succinct vector that keeps at most a given number of bytes of
+buffers in memory, spilling the rest to a scratch file.
+
+When the resident buffers exceed the budget, the least-recently-used
+full buffers are written to an anonymous scratch file and their
+directory entries are replaced by their file offset, tagged by setting
+the low bit. Accessing a spilled buffer reads it back, possibly
+spilling others. The last buffer is always resident, so push_back and
+pop_back work in memory.
+
+Buffer k is always spilled to offset k * (buffer size in bytes). Since
+rebuilds only merge pairs of adjacent buffers or split buffers in half,
+a merged or split buffer has the same bytes at the same offset, so
+rebuilds read at most one spilled buffer back in: the one merged with
+the last buffer, which must stay resident.
+
+When reading sequentially, the buffer after the one being read in is
+prefetched with posix_fadvise.
+
+Items must be trivially copyable, since buffers are written as bytes.
+This uses POSIX I/O, and throws std::runtime_error if it fails.
+
+ */
+
+#ifndef SUCCINCT_SPILL_VECTOR_HPP
+#define SUCCINCT_SPILL_VECTOR_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <cassert>
+#include <stdexcept>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+template<typename T>
+struct spill_vector : protected vector<T> {
+public:
+  typedef std::size_t size_t;
+  // budget_bytes is the number of bytes of buffers to keep in
+  // memory. The last buffer and the buffer most recently read in are
+  // kept regardless. The scratch file is created by tmpfile(3).
+  explicit spill_vector(const size_t budget_bytes);
+  spill_vector(const spill_vector &) = delete;
+  spill_vector & operator=(const spill_vector &) = delete;
+  ~spill_vector();
+  using vector<T>::size;
+  using vector<T>::capacity;
+  // Reads may load a buffer from the scratch file and spill another,
+  // so the reference is only valid until the next access. O(1)
+  // amortized, Θ(\sqrt{n}) worst case, plus I/O.
+  const T & operator[](const size_t) const;
+  T & operator[](const size_t);
+  // Add an item to the end of the vector. O(1) amortized, Θ(n) worst
+  // case.
+  void push_back(const T &);
+  // Delete an item from the end of the vector. The vector must be
+  // non-empty. O(1) amortized, Θ(n) worst case.
+  void pop_back();
+  // The number of bytes of buffers in memory
+  size_t resident_bytes() const;
+  // The number of buffers that are in the scratch file
+  size_t spilled_buffers() const;
+  // The number of times a buffer was read from or written to the
+  // scratch file
+  size_t loads() const;
+  size_t spills() const;
+
+protected:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "spill_vector writes items as bytes");
+  typedef typename vector<T>::length_t length_t;
+
+  size_t budget;
+  std::FILE * file;
+  int fd;
+  // When each buffer was last accessed, for LRU spilling
+  mutable vector<std::uint64_t> last_used;
+  // Whether each resident buffer differs from its copy in the file, if
+  // any
+  mutable vector<unsigned char> dirty;
+  mutable std::uint64_t clock;
+  // The last buffer read in, to detect sequential access
+  mutable length_t last_loaded;
+  mutable size_t load_count;
+  mutable size_t spill_count;
+
+  static bool
+  is_spilled(const T * const p) {
+    return 1 == (reinterpret_cast<std::uintptr_t>(p) & 1);
+  }
+
+  static off_t
+  untag(const T * const p) {
+    assert (is_spilled(p));
+    return static_cast<off_t>(reinterpret_cast<std::uintptr_t>(p) >> 1);
+  }
+
+  static T *
+  tag(const off_t offset) {
+    return reinterpret_cast<T *>(
+      (static_cast<std::uintptr_t>(offset) << 1) | 1);
+  }
+
+  size_t
+  buffer_bytes() const {
+    return sizeof(T) * this->buffer_capacity();
+  }
+
+  off_t
+  offset(const length_t k) const {
+    return static_cast<off_t>(k) * static_cast<off_t>(buffer_bytes());
+  }
+
+  void
+  read_fully(unsigned char * p, size_t n, off_t at) const {
+    while (n > 0) {
+      const ssize_t got = ::pread(fd, p, n, at);
+      if (got <= 0) {
+        throw std::runtime_error("spill_vector: scratch file read failed");
+      }
+      p += got;
+      n -= static_cast<size_t>(got);
+      at += got;
+    }
+  }
+
+  void
+  write_fully(const unsigned char * p, size_t n, off_t at) const {
+    while (n > 0) {
+      const ssize_t put = ::pwrite(fd, p, n, at);
+      if (put <= 0) {
+        throw std::runtime_error("spill_vector: scratch file write failed");
+      }
+      p += put;
+      n -= static_cast<size_t>(put);
+      at += put;
+    }
+  }
+
+  // Read spilled buffer k back in.
+  void
+  load(const length_t k) const {
+    T * & entry = this->dir[k];
+    const off_t at = untag(entry);
+    assert (at == offset(k));
+    T * const result = new T[this->buffer_capacity()];
+    read_fully(reinterpret_cast<unsigned char *>(result), buffer_bytes(), at);
+    entry = result;
+    dirty[k] = 0;
+    ++load_count;
+    if ((k == last_loaded + 1)
+        and (k + 2 < this->dir_size)
+        and is_spilled(this->dir[k+1])) {
+      ::posix_fadvise(fd, offset(k+1), static_cast<off_t>(buffer_bytes()),
+                      POSIX_FADV_WILLNEED);
+    }
+    last_loaded = k;
+    enforce_budget(k);
+  }
+
+  // Write resident buffer k out, if it has changed, and deallocate it.
+  void
+  spill(const length_t k) const {
+    T * & entry = this->dir[k];
+    assert (k + 1 < this->dir_size);
+    assert ((0 != entry) and not is_spilled(entry));
+    if (dirty[k]) {
+      write_fully(reinterpret_cast<const unsigned char *>(entry),
+                  buffer_bytes(), offset(k));
+    }
+    delete[] entry;
+    entry = tag(offset(k));
+    ++spill_count;
+  }
+
+  // Spill least-recently-used full buffers other than buffer keep
+  // until the resident buffers fit in the budget.
+  void
+  enforce_budget(const length_t keep) const {
+    size_t resident = resident_bytes();
+    while (resident > budget) {
+      length_t victim = this->dir_size;
+      for (length_t k = 0; k + 1 < this->dir_size; ++k) {
+        const T * const entry = this->dir[k];
+        if ((k == keep) or (0 == entry) or is_spilled(entry)) {
+          continue;
+        }
+        if ((this->dir_size == victim) or (last_used[k] < last_used[victim])) {
+          victim = k;
+        }
+      }
+      if (this->dir_size == victim) {
+        return;
+      }
+      spill(victim);
+      resident -= buffer_bytes();
+    }
+  }
+
+  // The resident buffer k, reading it in if necessary
+  T *
+  resident(const length_t k, const bool write) const {
+    last_used[k] = ++clock;
+    if (is_spilled(this->dir[k])) {
+      load(k);
+    }
+    if (write) {
+      dirty[k] = 1;
+    }
+    return this->dir[k];
+  }
+
+  // Before a rebuild, replace spilled directory entries by null, which
+  // rebuilds carry through as missing buffers. Buffers merged by the
+  // rebuild must be either both resident or both spilled. The last
+  // buffer is about to be written to, so it must stay resident: if it
+  // is merged with a spilled buffer, that one is read back in instead.
+  void
+  detach(const bool merging) {
+    const length_t last = this->dir_size - 1;
+    if (merging and is_spilled(this->dir[last^1])) {
+      resident(last^1, false);
+    }
+    for (length_t k = 0; k < this->dir_size; ++k) {
+      if (merging and is_spilled(this->dir[k^1]) and not is_spilled(this->dir[k])) {
+        dirty[k] = 1;
+        spill(k);
+      }
+    }
+    for (length_t k = 0; k < this->dir_size; ++k) {
+      if (is_spilled(this->dir[k])) {
+        this->dir[k] = 0;
+      }
+    }
+  }
+
+  // After a rebuild, every missing full buffer is spilled.
+  void
+  attach() {
+    last_used.resize(0);
+    last_used.resize(this->dir_capacity());
+    dirty.resize(0);
+    dirty.resize(this->dir_capacity());
+    for (length_t k = 0; k < this->dir_size; ++k) {
+      if (k + 1 < this->dir_size and 0 == this->dir[k]) {
+        this->dir[k] = tag(offset(k));
+      } else {
+        dirty[k] = 1;
+      }
+    }
+    last_loaded = this->dir_capacity();
+    enforce_budget(this->dir_size - 1);
+  }
+
+}; // struct spill_vector
+
+template<typename T>
+spill_vector<T>::spill_vector(const size_t budget_bytes) :
+  vector<T>(),
+  budget(budget_bytes),
+  file(std::tmpfile()),
+  fd(-1),
+  last_used(),
+  dirty(),
+  clock(0),
+  last_loaded(0),
+  load_count(0),
+  spill_count(0)
+{
+  if (0 == file) {
+    throw std::runtime_error("spill_vector: cannot create scratch file");
+  }
+  fd = ::fileno(file);
+  attach();
+}
+
+template<typename T>
+spill_vector<T>::~spill_vector() {
+  // The vector destructor cannot deallocate spilled buffers
+  for (length_t k = 0; k < this->dir_size; ++k) {
+    if (is_spilled(this->dir[k])) {
+      this->dir[k] = 0;
+    }
+  }
+  std::fclose(file);
+}
+
+template<typename T>
+const T &
+spill_vector<T>::operator[](const size_t i) const {
+  assert (i < size());
+  const length_t big = static_cast<length_t>(i >> this->log_buffer_capacity);
+  return resident(big, false)[i & (this->buffer_capacity() - 1)];
+}
+
+template<typename T>
+T &
+spill_vector<T>::operator[](const size_t i) {
+  assert (i < size());
+  const length_t big = static_cast<length_t>(i >> this->log_buffer_capacity);
+  return resident(big, true)[i & (this->buffer_capacity() - 1)];
+}
+
+template<typename T>
+void
+spill_vector<T>::push_back(const T & x) {
+  const bool rebuilds = this->push_back_rebuilds();
+  if (rebuilds) {
+    // A push_back rebuild merges buffers unless the buffers are
+    // already twice as big as the directory.
+    detach(not this->big_buffer);
+  }
+  last_used[this->dir_size-1] = ++clock;
+  dirty[this->dir_size-1] = 1;
+  vector<T>::push_back(x);
+  if (rebuilds) {
+    attach();
+  } else if (0 == this->last_buffer_size) {
+    // The buffer just filled is now eligible for spilling
+    dirty[this->dir_size-1] = 1;
+    enforce_budget(this->dir_size-1);
+  }
+}
+
+template<typename T>
+void
+spill_vector<T>::pop_back() {
+  assert (size() > 0);
+  const bool rebuilds = this->pop_back_rebuilds();
+  if (0 == this->last_buffer_size) {
+    // The buffer before the last one is about to become the last
+    // one, which must be resident.
+    resident(this->dir_size - 2, true);
+  }
+  if (rebuilds) {
+    // A pop_back rebuild only splits buffers.
+    detach(false);
+  }
+  vector<T>::pop_back();
+  if (rebuilds) {
+    attach();
+  }
+}
+
+template<typename T>
+size_t
+spill_vector<T>::resident_bytes() const {
+  const length_t end = this->dir_size + (this->extra_buffer ? 1 : 0);
+  size_t result = 0;
+  for (length_t k = 0; k < end; ++k) {
+    if ((0 != this->dir[k]) and not is_spilled(this->dir[k])) {
+      result += buffer_bytes();
+    }
+  }
+  return result;
+}
+
+template<typename T>
+size_t
+spill_vector<T>::spilled_buffers() const {
+  size_t result = 0;
+  for (length_t k = 0; k < this->dir_size; ++k) {
+    if (is_spilled(this->dir[k])) {
+      ++result;
+    }
+  }
+  return result;
+}
+
+template<typename T>
+size_t
+spill_vector<T>::loads() const {
+  return load_count;
+}
+
+template<typename T>
+size_t
+spill_vector<T>::spills() const {
+  return spill_count;
+}
+
+} // namespace succinct
+#endif
@@ -0,0 +1,244 @@
+/*
+An unbounded single-producer, single-consumer channel.
+
+Items are kept in a queue of buffers. The producer fills the buffer at
+the tail and the consumer drains the buffer at the head; a drained
+buffer is handed back to the producer to be reused for the next tail
+buffer. Each new buffer holds about \sqrt{n} items, where n is the
+number of items in flight when it is started, so the memory held is the
+items in flight plus O(\sqrt{n}) empty slots: the unfilled part of the
+tail buffer, the drained part of the head buffer, and one spare.
+
+The producer publishes the items it has written to the consumer with a
+single atomic store when a buffer fills, at the end of a batch, and
+when flush() or close() is called; single items pushed with push() are
+not visible until then. The consumer likewise reports its progress to
+the producer only once per buffer.
+
+ */
+
+#ifndef SUCCINCT_SPSC_CHANNEL_HPP
+#define SUCCINCT_SPSC_CHANNEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+namespace succinct {
+
+template<typename T>
+struct spsc_channel {
+public:
+  typedef std::size_t size_t;
+  spsc_channel();
+  spsc_channel(const spsc_channel &) = delete;
+  spsc_channel & operator=(const spsc_channel &) = delete;
+  ~spsc_channel();
+
+  // Producer side.
+  // Add an item, to be published when its buffer fills or at the next
+  // flush(). O(1) amortized, Θ(\sqrt{n}) worst case.
+  void push(const T &);
+  // Add the items in [first, last) and publish them.
+  void push(const T * first, const T * const last);
+  // Publish every item pushed so far.
+  void flush();
+  // Publish every item pushed so far and tell the consumer there will
+  // be no more. Nothing may be pushed afterwards.
+  void close();
+
+  // Consumer side.
+  // Move up to max published items to out, returning the number
+  // moved. This does not wait; 0 means nothing is published yet.
+  size_t try_pop(T * out, const size_t max);
+  bool try_pop(T &);
+  // Whether the channel is closed and every item has been popped
+  bool drained() const;
+
+protected:
+  struct chunk {
+    T * items;
+    size_t capacity;
+    // The number of items in this chunk the consumer may read
+    std::atomic<size_t> published;
+    std::atomic<chunk *> next;
+
+    explicit chunk(const size_t n) : 
+      items(new T[n]()), capacity(n), published(0), next(0) {}
+    ~chunk() { delete[] items; }
+  };
+
+  // The smallest buffer, so that even a nearly empty channel
+  // publishes in batches
+  static const size_t min_capacity = 256;
+
+  // The capacity of a new buffer when n items are in flight: the
+  // power of 2 at or above \sqrt{n}.
+  static size_t
+  capacity_for(const size_t n) {
+    size_t result = min_capacity;
+    while (result * result < n) {
+      result *= 2;
+    }
+    return result;
+  }
+
+  // Producer state, on its own cache line
+  alignas(64) chunk * tail;
+  size_t written;
+  size_t pushed;
+
+  // Consumer state
+  alignas(64) chunk * head;
+  size_t read;
+  // The number of items popped, reported once per buffer
+  std::atomic<size_t> popped;
+
+  // Shared
+  alignas(64) std::atomic<chunk *> spare;
+  std::atomic<bool> closed;
+
+  // Start a new tail buffer, reusing the spare one if it is about the
+  // right size.
+  void
+  grow() {
+    const size_t wanted = capacity_for(pushed - popped.load(std::memory_order_relaxed));
+    chunk * c = spare.exchange(0, std::memory_order_acquire);
+    if ((0 != c) and ((c->capacity < wanted) or (c->capacity > 2 * wanted))) {
+      delete c;
+      c = 0;
+    }
+    if (0 == c) {
+      c = new chunk(wanted);
+    } else {
+      c->published.store(0, std::memory_order_relaxed);
+      c->next.store(0, std::memory_order_relaxed);
+    }
+    // The consumer moves on only after reading a full chunk, so the
+    // full count must be visible before the link.
+    tail->published.store(written, std::memory_order_release);
+    tail->next.store(c, std::memory_order_release);
+    tail = c;
+    written = 0;
+  }
+
+}; // struct spsc_channel
+
+template<typename T>
+spsc_channel<T>::spsc_channel() :
+  tail(new chunk(min_capacity)),
+  written(0),
+  pushed(0),
+  head(tail),
+  read(0),
+  popped(0),
+  spare(0),
+  closed(false)
+{}
+
+template<typename T>
+spsc_channel<T>::~spsc_channel() {
+  while (0 != head) {
+    chunk * const next = head->next.load(std::memory_order_relaxed);
+    delete head;
+    head = next;
+  }
+  delete spare.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+void
+spsc_channel<T>::push(const T & x) {
+  if (written == tail->capacity) {
+    grow();
+  }
+  tail->items[written++] = x;
+  ++pushed;
+  if (written == tail->capacity) {
+    tail->published.store(written, std::memory_order_release);
+  }
+}
+
+template<typename T>
+void
+spsc_channel<T>::push(const T * first, const T * const last) {
+  while (first != last) {
+    if (written == tail->capacity) {
+      grow();
+    }
+    const size_t n = std::min(tail->capacity - written, 
+                              static_cast<size_t>(last - first));
+    std::copy(first, first + n, tail->items + written);
+    written += n;
+    pushed += n;
+    first += n;
+  }
+  flush();
+}
+
+template<typename T>
+void
+spsc_channel<T>::flush() {
+  tail->published.store(written, std::memory_order_release);
+}
+
+template<typename T>
+void
+spsc_channel<T>::close() {
+  flush();
+  closed.store(true, std::memory_order_release);
+}
+
+template<typename T>
+size_t
+spsc_channel<T>::try_pop(T * out, const size_t max) {
+  size_t result = 0;
+  while (result < max) {
+    if (read == head->capacity) {
+      chunk * const next = head->next.load(std::memory_order_acquire);
+      if (0 == next) {
+        break;
+      }
+      // Hand the drained buffer back to the producer.
+      chunk * const old = spare.exchange(head, std::memory_order_acq_rel);
+      delete old;
+      head = next;
+      read = 0;
+    }
+    const size_t available = 
+      head->published.load(std::memory_order_acquire) - read;
+    if (0 == available) {
+      break;
+    }
+    const size_t n = std::min(available, max - result);
+    std::copy(head->items + read, head->items + read + n, out);
+    out += n;
+    read += n;
+    result += n;
+    if (read == head->capacity) {
+      popped.fetch_add(head->capacity, std::memory_order_relaxed);
+    }
+  }
+  return result;
+}
+
+template<typename T>
+bool
+spsc_channel<T>::try_pop(T & x) {
+  return 1 == try_pop(&x, 1);
+}
+
+template<typename T>
+bool
+spsc_channel<T>::drained() const {
+  if (not closed.load(std::memory_order_acquire)) {
+    return false;
+  }
+  // Every item was published before the channel was closed.
+  return (head->next.load(std::memory_order_acquire) == 0)
+    and (read == head->published.load(std::memory_order_acquire));
+}
+
+} // namespace succinct
+#endif
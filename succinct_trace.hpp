@@ -0,0 +1,348 @@
+/*
+Recording the operations done on a succinct vector, and replaying
+them against any vector-like container.
+
+A traced_vector behaves like a vector, but also appends a record of
+every operation to a trace file: push_back, pop_back, each read or
+write of an item by index, append, resize, reserve and shrink_to_fit.
+Items themselves are not recorded, only the shape of the workload.
+Each record is one opcode byte followed, for operations that take one,
+by the index or count as a LEB128 varint, so a push_back costs one
+byte and a read of a nearby index a few. Records are buffered and
+written with fwrite.
+
+load_trace reads a trace file back, and replay runs it against a
+container: succinct::vector, std::vector, std::deque, or anything with
+push_back, pop_back, operator[], resize and size. reserve,
+shrink_to_fit, append and capacity are used if the container has them.
+replay counts how often the capacity changed, which for a succinct
+vector is once per rebuild and for std::vector once per reallocation.
+
+This uses C stdio, and throws std::runtime_error if it fails or the
+trace is malformed.
+
+ */
+
+#ifndef SUCCINCT_TRACE_HPP
+#define SUCCINCT_TRACE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include "succinct_vector.hpp"
+
+namespace succinct {
+
+enum trace_op {
+  trace_push_back = 0,
+  trace_pop_back = 1,
+  trace_read = 2,
+  trace_write = 3,
+  trace_append = 4,
+  trace_resize = 5,
+  trace_reserve = 6,
+  trace_shrink_to_fit = 7,
+  trace_op_count = 8
+};
+
+// Whether the operation is followed by an index or count
+inline bool
+trace_has_argument(const unsigned op) {
+  return (trace_push_back != op) and (trace_pop_back != op)
+    and (trace_shrink_to_fit != op);
+}
+
+struct trace_record {
+  std::uint8_t op;
+  std::uint64_t argument;
+};
+
+// The first bytes of every trace file
+static const char trace_magic[8] = {'S', 'U', 'C', 'C', 'T', 'R', 'C', 1};
+
+// Buffered writing of records to a trace file
+struct trace_writer {
+public:
+  explicit trace_writer(const char * const path);
+  trace_writer(const trace_writer &) = delete;
+  trace_writer & operator=(const trace_writer &) = delete;
+  ~trace_writer();
+  void
+  put(const trace_op op, std::uint64_t argument = 0) {
+    // An opcode and at most 10 bytes of varint
+    if (fill + 11 > sizeof(buffer)) {
+      flush();
+    }
+    buffer[fill++] = static_cast<unsigned char>(op);
+    if (trace_has_argument(op)) {
+      while (argument >= 0x80) {
+        buffer[fill++] = static_cast<unsigned char>(argument | 0x80);
+        argument >>= 7;
+      }
+      buffer[fill++] = static_cast<unsigned char>(argument);
+    }
+  }
+  // Write the buffered records to the file.
+  void flush();
+
+protected:
+  std::FILE * file;
+  std::size_t fill;
+  unsigned char buffer[4096];
+};
+
+inline
+trace_writer::trace_writer(const char * const path) :
+  file(std::fopen(path, "wb")),
+  fill(0)
+{
+  if (0 == file) {
+    throw std::runtime_error("succinct: cannot create trace file");
+  }
+  std::memcpy(buffer, trace_magic, sizeof(trace_magic));
+  fill = sizeof(trace_magic);
+}
+
+inline
+trace_writer::~trace_writer() {
+  // Destructors must not throw, so a failed final write is lost.
+  if (fill > 0) {
+    std::fwrite(buffer, 1, fill, file);
+  }
+  std::fclose(file);
+}
+
+inline void
+trace_writer::flush() {
+  if ((fill > 0) and (std::fwrite(buffer, 1, fill, file) != fill)) {
+    throw std::runtime_error("succinct: cannot write trace file");
+  }
+  fill = 0;
+  std::fflush(file);
+}
+
+template<typename T>
+struct traced_vector : protected vector<T> {
+public:
+  typedef std::size_t size_t;
+  // Record to a new trace file at path, replacing any file there.
+  explicit traced_vector(const char * const path) : vector<T>(), trace(path) {}
+  using vector<T>::size;
+  using vector<T>::capacity;
+  // The untraced vector
+  const vector<T> & items() const { return *this; }
+  // Reads are recorded as reads and non-const accesses as writes.
+  const T &
+  operator[](const size_t i) const {
+    trace.put(trace_read, i);
+    return vector<T>::operator[](i);
+  }
+  T &
+  operator[](const size_t i) {
+    trace.put(trace_write, i);
+    return vector<T>::operator[](i);
+  }
+  void
+  push_back(const T & x) {
+    trace.put(trace_push_back);
+    vector<T>::push_back(x);
+  }
+  void
+  pop_back() {
+    trace.put(trace_pop_back);
+    vector<T>::pop_back();
+  }
+  void
+  append(const T * const first, const T * const last) {
+    trace.put(trace_append, static_cast<std::uint64_t>(last - first));
+    vector<T>::append(first, last);
+  }
+  void
+  resize(const size_t n) {
+    trace.put(trace_resize, n);
+    vector<T>::resize(n);
+  }
+  void
+  reserve(const size_t n) {
+    trace.put(trace_reserve, n);
+    vector<T>::reserve(n);
+  }
+  void
+  shrink_to_fit() {
+    trace.put(trace_shrink_to_fit);
+    vector<T>::shrink_to_fit();
+  }
+  // Write the buffered records to the trace file. The destructor also
+  // does this.
+  void flush() { trace.flush(); }
+
+protected:
+  mutable trace_writer trace;
+};
+
+// The records in the trace file at path. Θ(size of the file).
+inline vector<trace_record>
+load_trace(const char * const path) {
+  std::FILE * const file = std::fopen(path, "rb");
+  if (0 == file) {
+    throw std::runtime_error("succinct: cannot open trace file");
+  }
+  vector<trace_record> result;
+  unsigned char buffer[4096];
+  std::size_t got = std::fread(buffer, 1, sizeof(trace_magic), file);
+  bool valid = (sizeof(trace_magic) == got)
+    and (0 == std::memcmp(buffer, trace_magic, sizeof(trace_magic)));
+  // The record being decoded, and how many bits of its argument have
+  // been read, or -1 if the next byte is an opcode
+  trace_record record = {0, 0};
+  int shift = -1;
+  while (valid and (got = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    for (std::size_t j = 0; j < got; ++j) {
+      const unsigned char byte = buffer[j];
+      if (shift < 0) {
+        record.op = byte;
+        record.argument = 0;
+        valid = valid and (byte < trace_op_count);
+        if (trace_has_argument(byte)) {
+          shift = 0;
+        } else {
+          result.push_back(record);
+        }
+        continue;
+      }
+      valid = valid and (shift < 64);
+      record.argument |= static_cast<std::uint64_t>(byte & 0x7f) << (shift & 63);
+      shift += 7;
+      if (0 == (byte & 0x80)) {
+        result.push_back(record);
+        shift = -1;
+      }
+    }
+  }
+  std::fclose(file);
+  if (not valid or (shift >= 0)) {
+    throw std::runtime_error("succinct: malformed trace file");
+  }
+  return result;
+}
+
+// Optional operations, used if C has them: the int overload is
+// preferred, and drops out if the expression in its return type is
+// ill-formed.
+template<typename C>
+auto
+replay_reserve(C & c, const std::size_t n, int) -> decltype(c.reserve(n), void()) {
+  c.reserve(n);
+}
+
+template<typename C>
+void
+replay_reserve(C &, std::size_t, long) {}
+
+template<typename C>
+auto
+replay_shrink_to_fit(C & c, int) -> decltype(c.shrink_to_fit(), void()) {
+  c.shrink_to_fit();
+}
+
+template<typename C>
+void
+replay_shrink_to_fit(C &, long) {}
+
+template<typename C, typename T>
+auto
+replay_append(C & c, const T * const first, const T * const last, int)
+  -> decltype(c.append(first, last), void()) {
+  c.append(first, last);
+}
+
+template<typename C, typename T>
+void
+replay_append(C & c, const T * const first, const T * const last, long) {
+  for (const T * p = first; p != last; ++p) {
+    c.push_back(*p);
+  }
+}
+
+template<typename C>
+auto
+replay_capacity(const C & c, int) -> decltype(static_cast<std::size_t>(c.capacity())) {
+  return c.capacity();
+}
+
+template<typename C>
+std::size_t
+replay_capacity(const C &, long) {
+  return 0;
+}
+
+struct replay_result {
+  // A sum of the items read, so that the reads cannot be optimized
+  // away
+  std::uint64_t checksum;
+  // The number of operations after which capacity() differed, or 0 if
+  // C has no capacity()
+  std::size_t capacity_changes;
+};
+
+// Run the operations in the trace against c, which should start empty.
+// Written items are set to the number of the operation. Θ(number of
+// records plus items appended).
+template<typename C>
+replay_result
+replay(const vector<trace_record> & trace, C & c) {
+  typedef typename C::value_type T;
+  T staging[256];
+  replay_result result = {0, 0};
+  std::size_t capacity = replay_capacity(c, 0);
+  std::uint64_t count = 0;
+  for_each(trace, [&](const trace_record & r) {
+      ++count;
+      const std::size_t argument = static_cast<std::size_t>(r.argument);
+      switch (r.op) {
+      case trace_push_back:
+        c.push_back(static_cast<T>(count));
+        break;
+      case trace_pop_back:
+        c.pop_back();
+        break;
+      case trace_read:
+        result.checksum += static_cast<std::uint64_t>(c[argument]);
+        break;
+      case trace_write:
+        c[argument] = static_cast<T>(count);
+        break;
+      case trace_append:
+        for (std::size_t done = 0; done < argument; ) {
+          const std::size_t n = std::min(argument - done, sizeof(staging) / sizeof(T));
+          for (std::size_t j = 0; j < n; ++j) {
+            staging[j] = static_cast<T>(count + j);
+          }
+          replay_append(c, staging, staging + n, 0);
+          done += n;
+        }
+        break;
+      case trace_resize:
+        c.resize(argument);
+        break;
+      case trace_reserve:
+        replay_reserve(c, argument, 0);
+        break;
+      case trace_shrink_to_fit:
+        replay_shrink_to_fit(c, 0);
+        break;
+      }
+      const std::size_t now = replay_capacity(c, 0);
+      if (now != capacity) {
+        ++result.capacity_changes;
+        capacity = now;
+      }
+    });
+  return result;
+}
+
+} // namespace succinct
+#endif
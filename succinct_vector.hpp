@@ -22,28 +22,140 @@ more constructors
 use allocators
 exception safety, especially on new and delete
 move constructor, for C++11
-iterators
 
  */
 
 #ifndef SUCCINCT_VECTOR_HPP
 #define SUCCINCT_VECTOR_HPP
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <cassert>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 202002L
+#include <compare>
+#include <ranges>
+#include <span>
+#endif
 
 namespace succinct {
 
+// Items that are equal exactly when their bytes are, so that they can
+// be compared with memcmp.
+template<typename T>
+struct is_bitwise_comparable : 
+  std::integral_constant<bool, 
+                         std::is_integral<T>::value 
+                         or std::is_enum<T>::value 
+                         or std::is_pointer<T>::value> {};
+
+// A random-access iterator over the items of a vector V, which is
+// either vector<T> or const vector<T>. Each access is an O(1) lookup
+// through the directory; to visit every item quickly, use for_each or
+// segment() instead.
+template<typename V, typename T>
+struct vector_iterator {
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef std::ptrdiff_t difference_type;
+  typedef typename std::conditional<std::is_const<V>::value, 
+                                    const T *, T *>::type pointer;
+  typedef typename std::conditional<std::is_const<V>::value, 
+                                    const T &, T &>::type reference;
+
+  vector_iterator() : v(0), i(0) {}
+  vector_iterator(V * const that, const std::size_t index) : v(that), i(index) {}
+  // A const_iterator can be made from an iterator, but not the other
+  // way around.
+  template<typename W, typename = typename std::enable_if<
+                         std::is_convertible<W *, V *>::value>::type>
+  vector_iterator(const vector_iterator<W, T> & that) : v(that.v), i(that.i) {}
+
+  reference operator*() const { return (*v)[i]; }
+  pointer operator->() const { return &(*v)[i]; }
+  reference 
+  operator[](const difference_type n) const { 
+    return (*v)[i + static_cast<std::size_t>(n)]; 
+  }
+
+  vector_iterator & operator++() { ++i; return *this; }
+  vector_iterator & operator--() { --i; return *this; }
+  vector_iterator operator++(int) { vector_iterator result = *this; ++i; return result; }
+  vector_iterator operator--(int) { vector_iterator result = *this; --i; return result; }
+  vector_iterator & 
+  operator+=(const difference_type n) { 
+    i += static_cast<std::size_t>(n); 
+    return *this; 
+  }
+  vector_iterator & 
+  operator-=(const difference_type n) { 
+    i -= static_cast<std::size_t>(n); 
+    return *this; 
+  }
+  vector_iterator 
+  operator+(const difference_type n) const { 
+    return vector_iterator(v, i + static_cast<std::size_t>(n)); 
+  }
+  vector_iterator 
+  operator-(const difference_type n) const { 
+    return vector_iterator(v, i - static_cast<std::size_t>(n)); 
+  }
+  friend vector_iterator 
+  operator+(const difference_type n, const vector_iterator & x) { 
+    return x + n; 
+  }
+  difference_type 
+  operator-(const vector_iterator & that) const {
+    return static_cast<difference_type>(i) - static_cast<difference_type>(that.i);
+  }
+
+  bool operator==(const vector_iterator & that) const { return i == that.i; }
+  bool operator!=(const vector_iterator & that) const { return i != that.i; }
+  bool operator<(const vector_iterator & that) const { return i < that.i; }
+  bool operator>(const vector_iterator & that) const { return i > that.i; }
+  bool operator<=(const vector_iterator & that) const { return i <= that.i; }
+  bool operator>=(const vector_iterator & that) const { return i >= that.i; }
+
+  V * v;
+  std::size_t i;
+};
+
+struct vector_access;
+
+// A summary of the shape and memory use of a vector
+struct vector_statistics {
+  std::size_t size;
+  std::size_t capacity;
+  std::size_t segment_capacity;
+  std::size_t directory_capacity;
+  // Including the extra buffer, if any
+  std::size_t allocated_buffers;
+  // The directory and the allocated buffers
+  std::size_t allocated_bytes;
+  // The capacity requested by reserve(), or 0
+  std::size_t reserved_capacity;
+};
+
 template<typename T>
 struct vector {
 public:
   typedef std::size_t size_t;
+  typedef T value_type;
+  typedef vector_iterator<vector, T> iterator;
+  typedef vector_iterator<const vector, T> const_iterator;
   //default constructor:
   vector();
   // copy constructor:
   vector(const vector &);
   // assignment operator
   vector &  operator=(const vector &);
+  // Exchange the items (and buffers) of two vectors. Θ(1).
+  void swap(vector &);
   size_t size() const;
   ~vector();
   const T & operator[](const size_t) const;
@@ -55,8 +167,85 @@ public:
   // non-empty when this function is called. O(1) amortized, Θ(n)
   // worst case.
   void pop_back();
+  // The largest size the vector can reach by push_back without
+  // rebuilding.
+  size_t capacity() const;
+  // Rebuild (at most once) so that the vector can hold n items
+  // without rebuilding again. Only the directory is allocated up
+  // front; buffers are allocated when push_back first reaches
+  // them. The vector will not downsize below this capacity until
+  // shrink_to_fit() is called. Θ(size()) worst case.
+  void reserve(const size_t n);
+  // Drop any reservation and the extra buffer, rebuilding to the
+  // smallest shape that holds the current items. Θ(size()).
+  void shrink_to_fit();
+  // Grow with default-valued items or shrink by discarding items
+  // from the end. O(|n - size()|) amortized.
+  void resize(const size_t n);
+  // Add the items in [first, last) to the end of the vector. This
+  // copies into the last buffer directly, calling push_back only for
+  // the item that fills each buffer. O(last - first) amortized.
+  void append(const T * first, const T * const last);
+  // Delete item i by moving the last item into its place. This does
+  // not preserve the order of the items. O(1) amortized, Θ(n) worst
+  // case.
+  void swap_remove(const size_t i);
+  // Delete every item x for which pred(x) is true, keeping the others
+  // in order. The survivors are moved down in a single pass, then the
+  // vector rebuilds at most once. Returns the number of items deleted.
+  // Θ(n).
+  template<typename Predicate>
+  size_t erase_if(Predicate pred);
+
+  // The items are stored contiguously in segments (the buffers).
+  // Every segment but the last holds segment_capacity() items; the
+  // last one may be empty. All O(1).
+  size_t segment_count() const;
+  size_t segment_capacity() const;
+  size_t segment_size(const size_t k) const;
+  const T * segment(const size_t k) const;
+  // Writing through the result is allowed.
+  T * segment(const size_t k);
+
+#if __cplusplus >= 202002L
+  // The segments, as a random-access range of std::span, so that
+  // std::views::join(v.segments()) visits the items a segment at a
+  // time.
+  auto segments() const;
+  auto segments();
+#endif
+
+  // Iterators make the vector a random-access (and, in C++20, sized)
+  // range.
+  iterator begin();
+  iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
+  const_iterator cbegin() const;
+  const_iterator cend() const;
+
+  // A 64-bit hash of the items, which does not depend on the shape.
+  // This uses the cached hashes of full buffers, if any, but does not
+  // add to the cache, so several threads may call it at once. It is
+  // Θ(n) without a cache, and O(\sqrt{n}) plus the size of the
+  // buffers written to since the last rehash().
+  std::uint64_t hash() const;
+  // As hash(), but first caches the hash of every full buffer that is
+  // not cached. The hash of a buffer stays cached until it is written
+  // to. Θ(size of the buffers hashed) plus O(\sqrt{n}).
+  std::uint64_t rehash();
+  // The hash of the items in segment k, which must be full and not
+  // the last segment. O(1) if it is cached, Θ(\sqrt{n}) otherwise.
+  std::uint64_t segment_hash(const size_t k) const;
+  // The cached hash of segment k, which must be full and not the
+  // last segment, or 0 if it is not cached. O(1).
+  std::uint64_t cached_segment_hash(const size_t k) const;
+
+  // The current shape and memory use. Θ(\sqrt{n}).
+  vector_statistics statistics() const;
   
 protected:
+  friend struct vector_access;
 
   // Since the buffers and the buffer index have size about \sqrt{n},
   // as long as size_t is uint64_t or smaller, we only need half as
@@ -64,7 +253,10 @@ protected:
   // we do to describe locations in the vector.
   typedef std::uint32_t length_t;
   
-  // The buffer directory, each entry of which is a pointer to a buffer:
+  // The buffer directory, each entry of which is a pointer to a
+  // buffer. Buffers are allocated lazily, so an entry may be null;
+  // entries past the last buffer (and the extra buffer, if any) are
+  // always null.
   T ** dir; 
   length_t dir_size; 
   // The last buffer may not be filled to capacity, so we need to keep
@@ -87,6 +279,15 @@ protected:
   // If there is an extra buffer, then the directory must have an
   // extra slot in which a pointer to that buffer is stored.
   bool extra_buffer : 1; 
+  // The log_2 of the total capacity requested by reserve(), or 0 if
+  // there is none. While log_capacity() <= log_reserved, the
+  // directory may be mostly empty and we do not downsize.
+  length_t log_reserved : 6;
+  // The cached hashes of each full buffer, as computed by
+  // hash_items(), or 0 if not known. This is null until rehash() is
+  // first called, and after any rebuild. Only non-const member
+  // functions write to it.
+  std::uint64_t * buffer_hashes;
 
   // These two capacity functions could be stored as member variables,
   // but that would take extra space.
@@ -102,6 +303,23 @@ protected:
     return (static_cast<length_t>(1) << log_buffer_capacity);
   }
 
+  // The log_2 of dir_capacity() * buffer_capacity().
+  length_t
+  log_capacity() const {
+    return 2 * log_buffer_capacity - (big_buffer ? 1 : 0);
+  }
+
+  // The smallest log_capacity() of a shape that can hold n items,
+  // remembering that the last buffer is never full.
+  static length_t
+  log_capacity_for(const size_t n) {
+    length_t result = 1;
+    while ((static_cast<size_t>(1) << result) <= n) {
+      ++result;
+    }
+    return result;
+  }
+
   void
   assert_valid() const {
 #ifdef NDEBUG
@@ -124,20 +342,91 @@ protected:
       // The pointer o the extra buffer is stored one-past-the end of
       // the dir, so there must be space for it.
       assert (dir_size < dir_capacity());
+      assert (0 != dir[dir_size]);
     }
 
-    assert ((dir_size + (extra_buffer ? 1 : 0)) * 4 >= dir_capacity());
+    assert ((log_capacity() <= log_reserved)
+            or ((dir_size + (extra_buffer ? 1 : 0)) * 4 >= dir_capacity()));
   }
 
 
 
+  // The hash of the items is \sum_i mix(x_i) * hash_base^{n-1-i}, mod
+  // 2^64, so the hash of a range of items can be combined with the
+  // hash of the items before it without knowing how they were split
+  // into buffers.
+  static const std::uint64_t hash_base = 0x9e3779b97f4a7c15ull;
+
+  static std::uint64_t
+  mix(std::uint64_t x) {
+    x ^= x >> 32;
+    x *= 0xd6e8feb86659fd93ull;
+    x ^= x >> 32;
+    return x;
+  }
+
+  template<typename U>
+  static std::uint64_t
+  hash_item(const U & x, std::true_type) {
+    return mix(static_cast<std::uint64_t>(x));
+  }
+
+  template<typename U>
+  static std::uint64_t
+  hash_item(const U & x, std::false_type) {
+    return mix(std::hash<U>()(x));
+  }
+
+  static std::uint64_t
+  hash_items(const T * const begin, const T * const end) {
+    std::uint64_t result = 0;
+    for (const T * p = begin; p != end; ++p) {
+      result = result * hash_base 
+        + hash_item(*p, std::integral_constant<bool, 
+                    std::is_integral<T>::value or std::is_enum<T>::value>());
+    }
+    return result;
+  }
+
+  // hash_base^n
+  static std::uint64_t
+  hash_base_power(size_t n) {
+    std::uint64_t result = 1;
+    std::uint64_t square = hash_base;
+    for (; n > 0; n >>= 1) {
+      if (n & 1) {
+        result *= square;
+      }
+      square *= square;
+    }
+    return result;
+  }
+
+  // Called whenever buffers change size or move.
+  void
+  forget_hashes() {
+    delete[] buffer_hashes;
+    buffer_hashes = 0;
+  }
+
+  // Called before buffer k is written to.
+  void
+  forget_hash(const size_t k) {
+    if (0 != buffer_hashes) {
+      buffer_hashes[k] = 0;
+    }
+  }
+
   // In an array that is valid except for the directory (and thus, the
   // buffers), make a valid directory and buffers by copying the ones
   // from another vector with the intended shape and size.
   void
   construct(const vector & that) {
-    assert_valid();
     for(length_t i = 0; i < dir_size; ++i) {
+      if (0 == that.dir[i]) {
+        dir[i] = 0;
+        continue;
+      }
       dir[i] = new T[buffer_capacity()];
       //Note: this copies everything, even the uninitialized items
       std::copy(that.dir[i], that.dir[i] + that.buffer_capacity(), dir[i]);
@@ -151,6 +440,7 @@ protected:
   // Deallocate (and destruct the items in) every buffer and the directory
   void
   destuct() {
+    forget_hashes();
     for (size_t i = 0; i < dir_size; ++i) {
       delete[] dir[i];
     }
@@ -160,6 +450,144 @@ protected:
     delete[] dir;
   }
 
+  // Rebuild to the shape with the given log_capacity(), which must be
+  // able to hold the current items. This does not need the
+  // invariants to hold beforehand. Each old buffer is deallocated as
+  // soon as its items have been copied, so this needs only O(\sqrt{n})
+  // space beyond the items themselves. Missing buffers stay missing.
+  void
+  reshape(const length_t new_log_capacity) {
+    forget_hashes();
+    const size_t n = size();
+    assert ((static_cast<size_t>(1) << new_log_capacity) > n);
+
+    const length_t new_log_buffer_capacity = (new_log_capacity + 1) / 2;
+    const bool new_big_buffer = (1 == (new_log_capacity & 1));
+    const size_t old_buf_cap = buffer_capacity();
+    const size_t new_buf_cap = static_cast<size_t>(1) << new_log_buffer_capacity;
+    T ** const new_dir = 
+      new T*[new_buf_cap >> (new_big_buffer ? 1 : 0)]();
+
+    // Both buffer capacities are powers of 2, so copying in chunks of
+    // the smaller capacity never straddles a buffer in either shape.
+    const size_t chunk = std::min(old_buf_cap, new_buf_cap);
+    for (size_t i = 0; i < n; i += chunk) {
+      const size_t len = std::min(chunk, n - i);
+      T * & src = dir[i >> log_buffer_capacity];
+      if (0 != src) {
+        T * & dst = new_dir[i >> new_log_buffer_capacity];
+        if (0 == dst) {
+          dst = new T[new_buf_cap]();
+        }
+        T * const from = src + (i & (old_buf_cap - 1));
+        std::copy(from, from + len, dst + (i & (new_buf_cap - 1)));
+      }
+      if (0 == ((i + len) & (old_buf_cap - 1))) {
+        delete[] src;
+        src = 0;
+      }
+    }
+    // Whatever is left: a partially-filled last buffer, an empty last
+    // buffer, or an extra buffer.
+    destuct();
+
+    dir = new_dir;
+    log_buffer_capacity = new_log_buffer_capacity & 31;
+    big_buffer = new_big_buffer;
+    extra_buffer = false;
+    dir_size = static_cast<length_t>(n >> new_log_buffer_capacity) + 1;
+    last_buffer_size = static_cast<length_t>(n & (new_buf_cap - 1));
+    // The directory may now be mostly empty, so the invariants only
+    // hold if the caller has reserved this shape or is about to grow.
+    assert (size() == n);
+  }
+
+  // Replace the items with n items that are default-initialized,
+  // which leaves trivial items indeterminate, in the smallest shape
+  // that holds them. Every buffer holding an item is allocated, so
+  // the items can be overwritten in place, in parallel. Any
+  // reservation is dropped. Θ(\sqrt{n}) plus the cost of
+  // default-initializing the items.
+  void
+  shape_for_overwrite(const size_t n) {
+    destuct();
+    const length_t new_log_capacity = log_capacity_for(n);
+    log_buffer_capacity = ((new_log_capacity + 1) / 2) & 31;
+    big_buffer = (1 == (new_log_capacity & 1));
+    extra_buffer = false;
+    log_reserved = 0;
+    dir = new T*[dir_capacity()]();
+    dir_size = static_cast<length_t>(n >> log_buffer_capacity) + 1;
+    last_buffer_size = static_cast<length_t>(n & (buffer_capacity() - 1));
+    for (length_t k = 0; k < dir_size; ++k) {
+      if ((k + 1 < dir_size) or (last_buffer_size > 0)) {
+        dir[k] = new T[buffer_capacity()];
+      }
+    }
+    assert_valid();
+    assert (size() == n);
+  }
+
+  // Add items up to a size of n, which must be at least size(). The
+  // new items are default-initialized, which leaves trivial items
+  // indeterminate, and every buffer holding one is allocated, so they
+  // can be overwritten in place. If the vector must grow, it rebuilds
+  // once to the smallest shape for n items; the reservation is left
+  // as it is. Θ(size()) worst case for the rebuild, plus the cost of
+  // default-initializing the new items.
+  void
+  grow_for_overwrite(const size_t n) {
+    assert (n >= size());
+    const length_t wanted = log_capacity_for(n);
+    if (wanted > log_capacity()) {
+      reshape(wanted);
+    }
+    const length_t new_dir_size = static_cast<length_t>(n >> log_buffer_capacity) + 1;
+    const length_t new_last_buffer_size = 
+      static_cast<length_t>(n & (buffer_capacity() - 1));
+    assert (new_dir_size <= dir_capacity());
+    for (length_t k = dir_size - 1; k < new_dir_size; ++k) {
+      forget_hash(k);
+      if ((0 == dir[k]) and ((k + 1 < new_dir_size) or (new_last_buffer_size > 0))) {
+        dir[k] = new T[buffer_capacity()];
+      }
+    }
+    if (new_dir_size > dir_size) {
+      // The extra buffer, if any, is now in use.
+      extra_buffer = false;
+    }
+    dir_size = new_dir_size;
+    last_buffer_size = new_last_buffer_size;
+    assert_valid();
+    assert (size() == n);
+  }
+
+  // Drop the items at n and after, deallocating the buffers past the
+  // new last one (and the extra buffer) and then rebuilding once if
+  // the directory is now too empty. Θ(n) worst case.
+  void
+  truncate(const size_t n) {
+    assert (n <= size());
+    const length_t new_dir_size = 
+      static_cast<length_t>(n >> log_buffer_capacity) + 1;
+    const length_t end = dir_size + (extra_buffer ? 1 : 0);
+    for (length_t k = new_dir_size; k < end; ++k) {
+      delete[] dir[k];
+      dir[k] = 0;
+    }
+    dir_size = new_dir_size;
+    last_buffer_size = static_cast<length_t>(n & (buffer_capacity() - 1));
+    extra_buffer = false;
+    forget_hash(dir_size - 1);
+    if ((dir_size * 4 <= dir_capacity()) and (log_capacity() > log_reserved)) {
+      // The smallest shape for n items has a directory at least half
+      // full.
+      reshape(std::max(log_capacity_for(n), static_cast<length_t>(log_reserved)));
+    }
+    assert_valid();
+    assert (size() == n);
+  }
+
   // Returns a reference to the ith item in the vector. Note that this
   // is actually const-unsafe - having a reference to that item allows
   // setting the value of that item. This is wrapped safely by the
@@ -177,10 +605,37 @@ protected:
     // indicates a programmer error, rather than a library error
     assert (big < static_cast<size_t>(dir_size)); 
     assert (little < static_cast<size_t>(buffer_capacity()));
+    // Buffers are allocated lazily, but never after they hold an item
+    assert (0 != dir[big]);
 
     return dir[big][little];
   }
 
+  // Whether the next push_back will rebuild the buffers or directory.
+  // Wrappers that keep per-buffer state use this to know when buffer
+  // indexes are about to change.
+  bool
+  push_back_rebuilds() const {
+    return (last_buffer_size + 1 == buffer_capacity())
+      and (not extra_buffer)
+      and (dir_size == dir_capacity());
+  }
+
+  // Whether the next pop_back will rebuild the buffers or directory.
+  bool
+  pop_back_rebuilds() const {
+    length_t count = dir_size + (extra_buffer ? 1 : 0);
+    if ((0 == last_buffer_size) and (0 == dir[dir_size-1])) {
+      // The missing last buffer is dropped rather than kept as an
+      // extra buffer.
+      --count;
+    } else if ((1 == last_buffer_size) and extra_buffer) {
+      // The extra buffer is deallocated.
+      --count;
+    }
+    return (count * 4 <= dir_capacity()) and (log_capacity() > log_reserved);
+  }
+
   // upsize gives gome empty space in the dir between dir_size and
   // dir_capacity
   void 
@@ -188,6 +643,7 @@ protected:
 #ifndef NDEBUG
     const size_t old_size = size();
 #endif
+    forget_hashes();
     if (big_buffer) {
       upsize_dir();
     } else {
@@ -201,6 +657,7 @@ protected:
 #ifndef NDEBUG
     const size_t old_size = size();
 #endif
+    forget_hashes();
     if (big_buffer) {
       downsize_buffers();
     } else {
@@ -216,7 +673,7 @@ protected:
     assert (big_buffer);
     const length_t old_dir_capacity = dir_capacity();
     T ** old_dir = dir;
-    dir = new T*[2*old_dir_capacity];
+    dir = new T*[2*old_dir_capacity]();
     std::copy(old_dir, old_dir + old_dir_capacity, dir);
     delete[] old_dir;
     big_buffer = false;
@@ -227,7 +684,7 @@ protected:
   downsize_dir() {
     const length_t old_dir_capacity = dir_capacity();
     T ** old_dir = dir;
-    dir = new T*[old_dir_capacity/2];
+    dir = new T*[old_dir_capacity/2]();
     std::copy(old_dir, old_dir + dir_size, dir);
     delete[] old_dir;
     big_buffer = true;
@@ -239,7 +696,7 @@ protected:
   upsize_buffers() {   
     assert (not big_buffer);
     assert (not extra_buffer);
-    assert (dir_size = dir_capacity());
+    assert (dir_size == dir_capacity());
     assert ((dir_capacity() & 1) == 0);
     assert (last_buffer_size == buffer_capacity()); 
     // note that this means the vector invariants do not hold at this point
@@ -251,13 +708,25 @@ protected:
     for(length_t i = 0; i < dir_size; i += 2) {
       T * const buf1  = dir[i];
       T * const buf2 = dir[i+1];
-      T * const bigdir = new T[2 * buf_cap];
+      if ((0 == buf1) and (0 == buf2)) {
+        // Missing buffers merge into a missing buffer
+        dir[i/2] = 0;
+        continue;
+      }
+      T * const bigdir = new T[2 * buf_cap]();
       dir[i/2] = bigdir;
-      std::copy(buf1, buf1 + buf_cap, bigdir);
-      std::copy(buf2, buf2 + buf_cap, bigdir + buf_cap);
+      if (0 != buf1) {
+        std::copy(buf1, buf1 + buf_cap, bigdir);
+      }
+      if (0 != buf2) {
+        std::copy(buf2, buf2 + buf_cap, bigdir + buf_cap);
+      }
       delete[] buf1;
       delete[] buf2;
     }
+    // The second half of the directory now points to deallocated
+    // buffers:
+    std::fill(dir + dir_size/2, dir + dir_size, static_cast<T *>(0));
   
     ++log_buffer_capacity;
     last_buffer_size *= 2;
@@ -288,6 +757,11 @@ protected:
       const auto k = dir_size-i-1;
       assert (k < dir_size - 1);
       T * const oldbuf  = dir[k];
+      if (0 == oldbuf) {
+        dir[2*k]   = 0;
+        dir[2*k+1] = 0;
+        continue;
+      }
       dir[2*k]   = new T[buf_cap/2];
       dir[2*k+1] = new T[buf_cap/2];
       std::copy(oldbuf,             oldbuf + buf_cap/2, dir[2*k  ]);
@@ -305,36 +779,58 @@ protected:
     // buffer_capacity(), so 2*dir_size - 1
     dir_size = 2*dir_size - 1;
 
-    dir[dir_size-1] = new T[buffer_capacity()];
+    // The new last buffer is empty, so it is allocated by push_back.
+    dir[dir_size-1] = 0;
     assert (0 == last_buffer_size);
   }
 
 
 }; // struct vector
 
+// Operations for the bulk loaders and algorithms in the other headers
+// that would be unsafe in vector's public interface.
+struct vector_access {
+  // See vector::shape_for_overwrite.
+  template<typename T>
+  static void
+  shape_for_overwrite(vector<T> & v, const std::size_t n) {
+    v.shape_for_overwrite(n);
+  }
+
+  // See vector::grow_for_overwrite.
+  template<typename T>
+  static void
+  grow_for_overwrite(vector<T> & v, const std::size_t n) {
+    v.grow_for_overwrite(n);
+  }
+};
+
 // Default constructor: size 0, capacity 2, max capacity before rebuild 4
 template<typename T> 
 vector<T>::vector() :
-  dir(new T*[1]),
+  dir(new T*[1]()),
   dir_size(1),
   last_buffer_size(0),
   log_buffer_capacity(1),
   big_buffer(true),
-  extra_buffer(false)
+  extra_buffer(false),
+  log_reserved(0),
+  buffer_hashes(0)
 {
-  dir[0] = new T[buffer_capacity()];
   assert_valid();
 }
   
   // copy constructor
 template<typename T> 
 vector<T>::vector(const vector<T> & that) :
-  dir(new T*[that.dir_capacity()]),
+  dir(new T*[that.dir_capacity()]()),
   dir_size(that.dir_size),
   last_buffer_size(that.last_buffer_size),
   log_buffer_capacity(that.log_buffer_capacity),
   big_buffer(that.big_buffer),
-  extra_buffer(that.extra_buffer)
+  extra_buffer(that.extra_buffer),
+  log_reserved(that.log_reserved),
+  buffer_hashes(0)
 {
   construct(that);
 }
@@ -345,17 +841,40 @@ vector<T> &
 vector<T>::operator=(const vector<T> & that) {
   destuct();
   
-  dir = new T*[that.dir_capacity()];
+  dir = new T*[that.dir_capacity()]();
   dir_size = that.dir_size;
   last_buffer_size = that.last_buffer_size;
   log_buffer_capacity = that.log_buffer_capacity;
   big_buffer = that.big_buffer;
   extra_buffer = that.extra_buffer;
+  log_reserved = that.log_reserved;
   
   construct(that);
   return *this;
 }
 
+template<typename T> 
+void
+vector<T>::swap(vector<T> & that) {
+  std::swap(dir, that.dir);
+  std::swap(dir_size, that.dir_size);
+  std::swap(last_buffer_size, that.last_buffer_size);
+  // Bit-fields cannot be bound to references
+  const length_t this_log_buffer_capacity = log_buffer_capacity;
+  const bool this_big_buffer = big_buffer;
+  const bool this_extra_buffer = extra_buffer;
+  const length_t this_log_reserved = log_reserved;
+  log_buffer_capacity = that.log_buffer_capacity;
+  big_buffer = that.big_buffer;
+  extra_buffer = that.extra_buffer;
+  log_reserved = that.log_reserved;
+  that.log_buffer_capacity = this_log_buffer_capacity & 31;
+  that.big_buffer = this_big_buffer;
+  that.extra_buffer = this_extra_buffer;
+  that.log_reserved = this_log_reserved & 63;
+  std::swap(buffer_hashes, that.buffer_hashes);
+}
+
 template<typename T> 
 size_t 
 vector<T>::size() const {
@@ -379,6 +898,8 @@ vector<T>::operator[](const size_t i) const {
 template<typename T> 
 T & 
 vector<T>::operator[](const size_t i) {
+  // The caller may write to the item
+  forget_hash(i >> log_buffer_capacity);
   return pget(i);
 }
 
@@ -396,27 +917,26 @@ vector<T>::push_back(const T & x) {
   // The last_buffer_size is less than buffer_capactiy as an
   // invariant of the data structure.
   assert (last_buffer_size < buffer_capacity());
-  dir[dir_size-1][last_buffer_size] = x;
+  T * & last_buffer = dir[dir_size-1];
+  if (0 == last_buffer) {
+    // Buffers are allocated the first time an item is put in them.
+    last_buffer = new T[buffer_capacity()]();
+  }
+  last_buffer[last_buffer_size] = x;
   // After this statement, the data structure invariants may no
   // longer be valid:
   ++last_buffer_size;
   
   if (last_buffer_size == buffer_capacity()) {
-    if (not extra_buffer) {
-      if (dir_size == dir_capacity()) {
-	// We don't have an extra buffer, and we don't have any room
-	// to add another buffer to the directory. We must rebuild:
-	upsize();
-      }
-      assert (dir_size < dir_capacity());
-      dir[dir_size] = new T[buffer_capacity()];
-      // At this point, we have an extra buffer, but we are just
-      // about to put it in the directory proper, thus making it not
-      // "extra" at all.
-      
-      // extra_buffer = true;
+    if ((not extra_buffer) and (dir_size == dir_capacity())) {
+      // We don't have an extra buffer, and we don't have any room
+      // to add another buffer to the directory. We must rebuild:
+      upsize();
     }
-    // Expand the directory, using the extra buffer as a new empty buffer
+    assert (dir_size < dir_capacity());
+    // Expand the directory, using the extra buffer (if there is one)
+    // as a new empty buffer. Otherwise the new last buffer is left
+    // unallocated until an item is put in it.
     ++dir_size;
     extra_buffer = false;
     last_buffer_size = 0;
@@ -445,7 +965,10 @@ vector<T>::pop_back() {
     assert (not extra_buffer);
     last_buffer_size = buffer_capacity() - 1;
     --dir_size;
-    extra_buffer = true;
+    // If the last buffer was never allocated, there is nothing to keep.
+    extra_buffer = (0 != dir[dir_size]);
+    // The new last buffer will be written to by push_back.
+    forget_hash(dir_size - 1);
   } else {
     --last_buffer_size;
     if ((0 == last_buffer_size)
@@ -456,11 +979,13 @@ vector<T>::pop_back() {
       // an empty buffer because the structure invariants ensure
       // that last_buffer_size < buffer_capacity().
       delete[] dir[dir_size];
+      dir[dir_size] = 0;
       extra_buffer = false;
       
     }
   }
-  if ((dir_size + (extra_buffer ? 1 : 0)) * 4 <= dir_capacity()) {
+  if (((dir_size + (extra_buffer ? 1 : 0)) * 4 <= dir_capacity())
+      and (log_capacity() > log_reserved)) {
     // If the inequality was strict, we must have been equal before
     // this push_back, which means we should have already downsized.
     assert ((dir_size + (extra_buffer ? 1 : 0)) * 4 == dir_capacity());
@@ -471,6 +996,402 @@ vector<T>::pop_back() {
   assert (size() +1 == old_size);
 }
 
+template<typename T>
+vector_statistics
+vector<T>::statistics() const {
+  vector_statistics result;
+  result.size = size();
+  result.capacity = capacity();
+  result.segment_capacity = buffer_capacity();
+  result.directory_capacity = dir_capacity();
+  result.allocated_buffers = 0;
+  const length_t end = dir_size + (extra_buffer ? 1 : 0);
+  for (length_t k = 0; k < end; ++k) {
+    if (0 != dir[k]) {
+      ++result.allocated_buffers;
+    }
+  }
+  result.allocated_bytes = dir_capacity() * sizeof(T *)
+    + result.allocated_buffers * buffer_capacity() * sizeof(T);
+  result.reserved_capacity = 
+    (0 == log_reserved) ? 0 : (static_cast<size_t>(1) << log_reserved) - 1;
+  return result;
+}
+
+template<typename T>
+size_t
+vector<T>::capacity() const {
+  return (static_cast<size_t>(1) << log_capacity()) - 1;
+}
+
+template<typename T>
+void
+vector<T>::reserve(const size_t n) {
+  const length_t wanted = log_capacity_for(n);
+  if (wanted > log_reserved) {
+    log_reserved = wanted & 63;
+  }
+  if (wanted > log_capacity()) {
+    reshape(wanted);
+  }
+  assert_valid();
+  assert (capacity() >= n);
+}
+
+template<typename T>
+void
+vector<T>::shrink_to_fit() {
+  log_reserved = 0;
+  const length_t wanted = log_capacity_for(size());
+  if ((wanted < log_capacity()) or extra_buffer) {
+    reshape(wanted);
+  }
+  assert_valid();
+}
+
+template<typename T>
+void
+vector<T>::resize(const size_t n) {
+  while (size() < n) {
+    push_back(T());
+  }
+  while (size() > n) {
+    pop_back();
+  }
+  assert (size() == n);
+}
+
+template<typename T>
+void
+vector<T>::append(const T * first, const T * const last) {
+  while (first != last) {
+    T * & last_buffer = dir[dir_size-1];
+    if (0 == last_buffer) {
+      last_buffer = new T[buffer_capacity()]();
+    }
+    // Leave room for one item, since the last buffer is never full
+    const size_t room = buffer_capacity() - 1 - last_buffer_size;
+    const size_t n = std::min(room, static_cast<size_t>(last - first));
+    std::copy(first, first + n, last_buffer + last_buffer_size);
+    last_buffer_size += static_cast<length_t>(n);
+    first += n;
+    if (first != last) {
+      // This fills the buffer and moves on to the next one
+      push_back(*first);
+      ++first;
+    }
+  }
+  assert_valid();
+}
+
+template<typename T>
+void
+vector<T>::swap_remove(const size_t i) {
+  assert (i < size());
+  const size_t last = size() - 1;
+  if (i != last) {
+    (*this)[i] = pget(last);
+  }
+  pop_back();
+}
+
+template<typename T>
+template<typename Predicate>
+size_t
+vector<T>::erase_if(Predicate pred) {
+  // The write cursor, as a buffer and an index in it
+  length_t to = 0;
+  size_t to_index = 0;
+  size_t kept = 0;
+  for (length_t k = 0; k < dir_size; ++k) {
+    const size_t m = segment_size(k);
+    T * const x = dir[k];
+    for (size_t j = 0; j < m; ++j) {
+      if (pred(static_cast<const T &>(x[j]))) {
+        continue;
+      }
+      if (kept != (static_cast<size_t>(k) << log_buffer_capacity) + j) {
+        forget_hash(to);
+        dir[to][to_index] = x[j];
+      }
+      ++kept;
+      if (++to_index == buffer_capacity()) {
+        ++to;
+        to_index = 0;
+      }
+    }
+  }
+  const size_t result = size() - kept;
+  truncate(kept);
+  return result;
+}
+
+template<typename T>
+size_t
+vector<T>::segment_count() const {
+  return dir_size;
+}
+
+template<typename T>
+size_t
+vector<T>::segment_capacity() const {
+  return buffer_capacity();
+}
+
+template<typename T>
+size_t
+vector<T>::segment_size(const size_t k) const {
+  assert (k < dir_size);
+  return (k + 1 == dir_size) ? last_buffer_size : buffer_capacity();
+}
+
+template<typename T>
+const T *
+vector<T>::segment(const size_t k) const {
+  assert (k < dir_size);
+  return dir[k];
+}
+
+template<typename T>
+T *
+vector<T>::segment(const size_t k) {
+  assert (k < dir_size);
+  forget_hash(k);
+  return dir[k];
+}
+
+#if __cplusplus >= 202002L
+template<typename T>
+auto
+vector<T>::segments() const {
+  return std::views::iota(static_cast<size_t>(0), segment_count())
+    | std::views::transform([this](const size_t k) {
+        return std::span<const T>(segment(k), segment_size(k));
+      });
+}
+
+template<typename T>
+auto
+vector<T>::segments() {
+  // Writing through the spans is allowed, so the hash of each segment
+  // is forgotten when its span is made.
+  return std::views::iota(static_cast<size_t>(0), segment_count())
+    | std::views::transform([this](const size_t k) {
+        return std::span<T>(segment(k), segment_size(k));
+      });
+}
+#endif
+
+template<typename T>
+typename vector<T>::iterator
+vector<T>::begin() {
+  return iterator(this, 0);
+}
+
+template<typename T>
+typename vector<T>::iterator
+vector<T>::end() {
+  return iterator(this, size());
+}
+
+template<typename T>
+typename vector<T>::const_iterator
+vector<T>::begin() const {
+  return const_iterator(this, 0);
+}
+
+template<typename T>
+typename vector<T>::const_iterator
+vector<T>::end() const {
+  return const_iterator(this, size());
+}
+
+template<typename T>
+typename vector<T>::const_iterator
+vector<T>::cbegin() const {
+  return begin();
+}
+
+template<typename T>
+typename vector<T>::const_iterator
+vector<T>::cend() const {
+  return end();
+}
+
+template<typename T>
+std::uint64_t
+vector<T>::cached_segment_hash(const size_t k) const {
+  assert (k + 1 < dir_size);
+  return (0 == buffer_hashes) ? 0 : buffer_hashes[k];
+}
+
+template<typename T>
+std::uint64_t
+vector<T>::segment_hash(const size_t k) const {
+  const std::uint64_t cached = cached_segment_hash(k);
+  return (0 != cached) ? cached : hash_items(dir[k], dir[k] + buffer_capacity());
+}
+
+template<typename T>
+std::uint64_t
+vector<T>::rehash() {
+  if (0 == buffer_hashes) {
+    buffer_hashes = new std::uint64_t[dir_capacity()]();
+  }
+  for (length_t k = 0; k + 1 < dir_size; ++k) {
+    if (0 == buffer_hashes[k]) {
+      buffer_hashes[k] = hash_items(dir[k], dir[k] + buffer_capacity());
+    }
+  }
+  return hash();
+}
+
+template<typename T>
+std::uint64_t
+vector<T>::hash() const {
+  const std::uint64_t full_power = hash_base_power(buffer_capacity());
+  std::uint64_t result = 0;
+  for (length_t k = 0; k + 1 < dir_size; ++k) {
+    result = result * full_power + segment_hash(k);
+  }
+  // The last buffer is not cached, since push_back writes to it.
+  if (last_buffer_size > 0) {
+    const T * const last = dir[dir_size-1];
+    result = result * hash_base_power(last_buffer_size)
+      + hash_items(last, last + last_buffer_size);
+  }
+  return mix(result ^ size());
+}
+
+// Call f on each item in order, a segment at a time, and return f.
+// This is faster than going through iterators, since it looks up
+// each segment once. Θ(n).
+template<typename T, typename Function>
+Function
+for_each(const vector<T> & v, Function f) {
+  for (size_t k = 0; k < v.segment_count(); ++k) {
+    const T * const x = v.segment(k);
+    const size_t m = v.segment_size(k);
+    for (size_t j = 0; j < m; ++j) {
+      f(x[j]);
+    }
+  }
+  return f;
+}
+
+template<typename T, typename Function>
+Function
+for_each(vector<T> & v, Function f) {
+  for (size_t k = 0; k < v.segment_count(); ++k) {
+    T * const x = v.segment(k);
+    const size_t m = v.segment_size(k);
+    for (size_t j = 0; j < m; ++j) {
+      f(x[j]);
+    }
+  }
+  return f;
+}
+
+// The items at [begin, begin + n) and [that, that + n) are the same
+// up to the returned offset.
+template<typename T>
+size_t
+first_difference(const T * const begin, const T * const that, const size_t n) {
+  if (is_bitwise_comparable<T>::value) {
+    if (0 == std::memcmp(begin, that, n * sizeof(T))) {
+      return n;
+    }
+  }
+  return static_cast<size_t>(std::mismatch(begin, begin + n, that).first - begin);
+}
+
+// The first index at which a and b differ, or the size of the smaller
+// one if it is a prefix of the other. This compares contiguous runs
+// of items at once, even if a and b have different shapes. O(n)
+template<typename T>
+size_t
+mismatch(const vector<T> & a, const vector<T> & b) {
+  const size_t n = std::min(a.size(), b.size());
+  const size_t a_cap = a.segment_capacity();
+  const size_t b_cap = b.segment_capacity();
+  // Both capacities are powers of 2, so no chunk straddles a segment
+  const size_t chunk = std::min(a_cap, b_cap);
+  for (size_t i = 0; i < n; i += chunk) {
+    const size_t len = std::min(chunk, n - i);
+    const size_t d = first_difference(a.segment(i / a_cap) + (i & (a_cap - 1)),
+                                      b.segment(i / b_cap) + (i & (b_cap - 1)),
+                                      len);
+    if (d < len) {
+      return i + d;
+    }
+  }
+  return n;
+}
+
+template<typename T>
+bool
+operator==(const vector<T> & a, const vector<T> & b) {
+  return (a.size() == b.size()) and (mismatch(a, b) == a.size());
+}
+
+template<typename T>
+bool
+operator!=(const vector<T> & a, const vector<T> & b) {
+  return not (a == b);
+}
+
+// Lexicographic comparison
+template<typename T>
+bool
+operator<(const vector<T> & a, const vector<T> & b) {
+  const size_t i = mismatch(a, b);
+  if ((i < a.size()) and (i < b.size())) {
+    return a[i] < b[i];
+  }
+  return a.size() < b.size();
+}
+
+template<typename T>
+bool
+operator>(const vector<T> & a, const vector<T> & b) {
+  return b < a;
+}
+
+template<typename T>
+bool
+operator<=(const vector<T> & a, const vector<T> & b) {
+  return not (b < a);
+}
+
+template<typename T>
+bool
+operator>=(const vector<T> & a, const vector<T> & b) {
+  return not (a < b);
+}
+
+#if __cplusplus >= 202002L
+template<typename T>
+std::compare_three_way_result_t<T>
+operator<=>(const vector<T> & a, const vector<T> & b) {
+  const size_t i = mismatch(a, b);
+  if ((i < a.size()) and (i < b.size())) {
+    return std::compare_three_way()(a[i], b[i]);
+  }
+  return a.size() <=> b.size();
+}
+#endif
+
 
 } // namespace succinct
+
+namespace std {
+template<typename T>
+struct hash<succinct::vector<T> > {
+  size_t
+  operator()(const succinct::vector<T> & x) const {
+    return static_cast<size_t>(x.hash());
+  }
+};
+} // namespace std
+
 #endif
@@ -1,11 +1,39 @@
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <ctime>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
 #include "succinct_vector.hpp"
+#include "succinct_sparse_vector.hpp"
+#include "succinct_dict_vector.hpp"
+#include "succinct_delta_vector.hpp"
+#include "succinct_cold_vector.hpp"
+#include "succinct_spill_vector.hpp"
+#include "succinct_diff.hpp"
+#include "succinct_filter.hpp"
+#include "succinct_scan.hpp"
+#include "succinct_aggregate.hpp"
+#include "succinct_merge.hpp"
+#include "succinct_radix_sort.hpp"
+#include "succinct_log_vector.hpp"
+#include "succinct_spsc_channel.hpp"
+#include "succinct_mpmc_queue.hpp"
+#include "succinct_io.hpp"
+#include "succinct_crc32c.hpp"
+#include "succinct_mapped_vector.hpp"
+#include "succinct_parse.hpp"
+#include "succinct_arrow.hpp"
+#include "succinct_npy.hpp"
+#include "succinct_trace.hpp"
+#include "succinct_adaptive_vector.hpp"
 
 void qux() {
   succinct::vector<double> foo;
@@ -31,10 +59,1244 @@ void qux() {
   //foo.get(10);
 }
 
+void reserve_test() {
+  succinct::vector<unsigned> foo;
+  const unsigned limit = 40000;
+  foo.reserve(limit);
+  assert (foo.capacity() >= limit);
+  const auto reserved = foo.capacity();
+  for(unsigned i = 0; i < limit; ++i) {
+    foo.push_back(i);
+    assert (foo.capacity() == reserved);
+  }
+  for(unsigned i = 0; i < limit; ++i) {
+    assert (foo[i] == i);
+  }
+  // Popping does not give up the reservation
+  while (foo.size() > 10) {
+    foo.pop_back();
+  }
+  assert (foo.capacity() == reserved);
+  foo.shrink_to_fit();
+  assert (foo.capacity() < 32);
+  for(unsigned i = 0; i < 10; ++i) {
+    assert (foo[i] == i);
+  }
+  foo.resize(1000);
+  assert (foo.size() == 1000);
+  assert (foo[9] == 9);
+  assert (foo[10] == 0);
+  foo.resize(5);
+  assert (foo.size() == 5);
+  assert (foo[4] == 4);
+  // Copies of reserved vectors are reserved, too
+  foo.reserve(limit);
+  const succinct::vector<unsigned> bar(foo);
+  assert (bar.capacity() == foo.capacity());
+  assert (bar.size() == 5);
+}
+
+void sparse_test() {
+  succinct::sparse_vector<unsigned> foo;
+  const unsigned limit = 1u << 20;
+  foo.resize(limit);
+  assert (foo.size() == limit);
+  assert (foo.allocated_buffers() == 0);
+  const succinct::sparse_vector<unsigned> & cfoo = foo;
+  assert (cfoo[12345] == 0);
+  assert (foo.allocated_buffers() == 0);
+  foo[12345] = 7;
+  foo[limit - 1] = 8;
+  assert (foo.allocated_buffers() == 2);
+  assert (cfoo[12345] == 7);
+  assert (cfoo[12346] == 0);
+  foo.push_back(9);
+  assert (cfoo[limit] == 9);
+  // Items discarded by pop_back and resize do not reappear
+  foo.pop_back();
+  foo.pop_back();
+  foo.resize(limit + 1);
+  assert (cfoo[limit - 1] == 0);
+  assert (cfoo[limit] == 0);
+  foo.resize(12346);
+  assert (cfoo[12345] == 7);
+  assert (foo.allocated_buffers() == 1);
+  foo.resize(3);
+  foo.resize(limit);
+  assert (cfoo[12345] == 0);
+  for(unsigned i = 0; i < limit; i += 997) {
+    foo[i] = i;
+  }
+  const succinct::sparse_vector<unsigned> bar(foo);
+  for(unsigned i = 0; i < limit; ++i) {
+    assert (bar[i] == ((i % 997) ? 0 : i));
+  }
+  // Rebuilds keep missing buffers missing
+  succinct::sparse_vector<unsigned> baz;
+  baz.resize(1000);
+  baz[3] = 3;
+  for(unsigned i = 1000; i < limit; ++i) {
+    baz.push_back(i);
+  }
+  while (baz.size() > 4) {
+    baz.pop_back();
+  }
+  assert (baz.allocated_buffers() <= 2);
+  const succinct::sparse_vector<unsigned> & cbaz = baz;
+  assert (cbaz[3] == 3);
+  assert (cbaz[2] == 0);
+}
+
+bool is_odd(const unsigned x) {
+  return 1 == (x & 1);
+}
+
+void dict_test() {
+  succinct::dict_vector<string> foo;
+  const char * const names[] = {"red", "green", "blue"};
+  for(unsigned i = 0; i < 1000; ++i) {
+    foo.push_back(names[i % 3]);
+  }
+  assert (foo.code_width() == 2);
+  assert (foo.dictionary().size() == 3);
+  assert (foo[302] == "blue");
+  assert (foo.count("red") == 334);
+  assert (foo.count("black") == 0);
+
+  succinct::dict_vector<unsigned> bar;
+  const unsigned limit = 20000;
+  for(unsigned i = 0; i < limit; ++i) {
+    bar.push_back(i % 300);
+    assert (bar[i / 2] == (i / 2) % 300);
+  }
+  // 300 distinct values need 16-bit codes
+  assert (bar.code_width() == 16);
+  for(unsigned i = 0; i < limit; ++i) {
+    assert (bar[i] == i % 300);
+  }
+  unsigned odd = 0;
+  for(unsigned i = 0; i < limit; ++i) {
+    odd += is_odd(bar[i]) ? 1 : 0;
+  }
+  assert (bar.count_if(is_odd) == odd);
+  for(unsigned i = 0; i < 7; ++i) {
+    bar.pop_back();
+  }
+  assert (bar.size() == limit - 7);
+  assert (bar.count(0) == (limit - 7 + 299) / 300);
+  bar.set(1, 0);
+  assert (bar[1] == 0);
+  assert (bar.count(0) == (limit - 7 + 299) / 300 + 1);
+}
+
+struct summer {
+  long long * total;
+  void operator()(const long long x) const { *total += x; }
+};
+
+void delta_test() {
+  succinct::delta_vector<long long> foo;
+  succinct::vector<long long> bar;
+  const unsigned limit = 100000;
+  long long counter = -5000;
+  for(unsigned i = 0; i < limit; ++i) {
+    counter += rand() % 100 - 10;
+    foo.push_back(counter);
+    bar.push_back(counter);
+  }
+  assert (foo.size() == limit);
+  for(unsigned j = 0; j < limit; ++j) {
+    const auto k = rand() % limit;
+    assert (foo[k] == bar[k]);
+  }
+  // Differences below 2^7 take one or two bytes instead of eight
+  assert (foo.compressed_bytes() * 3 < limit * sizeof(long long));
+  long long total = 0, expected = 0;
+  summer s = {&total};
+  foo.for_each(s);
+  for(unsigned i = 0; i < limit; ++i) {
+    expected += bar[i];
+  }
+  assert (total == expected);
+  const succinct::delta_vector<long long> baz(foo);
+  for(unsigned i = 0; i < 5000; ++i) {
+    foo.pop_back();
+  }
+  assert (foo.size() == limit - 5000);
+  for(unsigned i = 0; i < foo.size(); ++i) {
+    assert (foo[i] == bar[i]);
+  }
+  assert (baz.size() == limit);
+  assert (baz[limit - 1] == bar[limit - 1]);
+  // Going back and forth across a block boundary freezes or thaws
+  // once, not on every step
+  succinct::delta_vector<int> qux;
+  for(int i = 0; i < 3 * 4096; ++i) {
+    qux.push_back(i);
+  }
+  for(unsigned i = 0; i < 10000; ++i) {
+    qux.push_back(-1);
+    qux.pop_back();
+  }
+  assert (qux.freezes() == 2);
+  for(unsigned i = 0; i < 4096; ++i) {
+    qux.pop_back();
+  }
+  for(unsigned i = 0; i < 10000; ++i) {
+    qux.pop_back();
+    qux.push_back(2 * 4096 - 1);
+  }
+  assert (qux.thaws() == 1);
+  assert (qux.freezes() == 2);
+  assert (qux.size() == 2 * 4096);
+  for(unsigned i = 0; i < qux.size(); ++i) {
+    assert (qux[i] == static_cast<int>(i));
+  }
+}
+
+void cold_test() {
+  succinct::cold_vector<double> foo(2);
+  const unsigned limit = 100000;
+  for(unsigned i = 0; i < limit; ++i) {
+    foo.push_back(i % 100);
+  }
+  // Everything was touched by the last rebuild
+  foo.compress_cold();
+  assert (foo.compress_cold() > 0);
+  assert (foo.compressed_bytes() * 4 < limit * sizeof(double));
+  const succinct::cold_vector<double> & cfoo = foo;
+  for(unsigned i = 0; i < limit; ++i) {
+    assert (cfoo[i] == i % 100);
+  }
+  // Sequential reads miss once per buffer
+  assert (foo.cache_hits() > foo.cache_misses());
+  const auto compressed = foo.compressed_buffers();
+  foo[5] = 7;
+  assert (foo.compressed_buffers() + 1 == compressed);
+  assert (cfoo[5] == 7);
+  foo[5] = 5;
+  foo.compress_cold();
+  foo.compress_cold();
+  while (foo.size() > 1) {
+    foo.pop_back();
+    assert (cfoo[foo.size() - 1] == static_cast<double>((foo.size() - 1) % 100));
+  }
+  assert (cfoo[0] == 0);
+  for(unsigned i = 1; i < limit; ++i) {
+    foo.push_back(i);
+  }
+  foo.compress_cold();
+  foo.compress_cold();
+  for(unsigned i = 1; i < limit; ++i) {
+    assert (cfoo[i] == i);
+  }
+}
+
+void spill_test() {
+  const unsigned budget = 1u << 14;
+  succinct::spill_vector<unsigned> foo(budget);
+  const unsigned limit = 200000;
+  for(unsigned i = 0; i < limit; ++i) {
+    foo.push_back(i);
+  }
+  assert (foo.spilled_buffers() > 0);
+  // At most the last buffer and one more are over budget
+  const auto buffer_bytes = foo.resident_bytes() / 3 + 1;
+  assert (foo.resident_bytes() <= budget + 2 * buffer_bytes);
+  const succinct::spill_vector<unsigned> & cfoo = foo;
+  for(unsigned i = 0; i < limit; ++i) {
+    assert (cfoo[i] == i);
+  }
+  for(unsigned j = 0; j < limit; ++j) {
+    const auto k = static_cast<unsigned>(rand()) % limit;
+    assert (cfoo[k] == k);
+    foo[k] = k;
+  }
+  // Writes survive being spilled
+  foo[17] = 18;
+  for(unsigned i = 0; i < limit; ++i) {
+    const auto k = (i * 7919) % limit;
+    assert (cfoo[k] == ((17 == k) ? 18 : k));
+  }
+  assert (cfoo[17] == 18);
+  foo[17] = 17;
+  assert (foo.loads() > 0);
+  while (foo.size() > 0) {
+    foo.pop_back();
+    assert (0 == foo.size() or cfoo[foo.size() - 1] == foo.size() - 1);
+  }
+  // Budgets smaller than two buffers still keep every item
+  for(unsigned small_budget = 64; small_budget <= 1024; small_budget *= 4) {
+    succinct::spill_vector<unsigned> bar(small_budget);
+    for(unsigned i = 0; i < limit; ++i) {
+      bar.push_back(i);
+    }
+    assert (bar.spilled_buffers() > 0);
+    const succinct::spill_vector<unsigned> & cbar = bar;
+    for(unsigned i = 0; i < limit; ++i) {
+      assert (cbar[i] == i);
+    }
+    while (bar.size() > 0) {
+      bar.pop_back();
+      assert (0 == bar.size() or cbar[bar.size() - 1] == bar.size() - 1);
+    }
+  }
+}
+
+void compare_test() {
+  succinct::vector<int> foo, bar;
+  const int limit = 30000;
+  // Give bar a different shape from foo
+  bar.reserve(4 * limit);
+  for(int i = 0; i < limit; ++i) {
+    foo.push_back(i);
+    bar.push_back(i);
+  }
+  assert (foo.segment_capacity() != bar.segment_capacity());
+  assert (foo == bar);
+  assert (not (foo < bar));
+  assert (foo.hash() == bar.hash());
+  assert (std::hash<succinct::vector<int> >()(foo) == foo.hash());
+  // Const hashing does not write to the cache, so threads may share it.
+  std::uint64_t hashes[2];
+  std::thread hasher([&]() { hashes[0] = bar.hash(); });
+  hashes[1] = bar.hash();
+  hasher.join();
+  assert (hashes[0] == hashes[1] and hashes[0] == foo.rehash());
+  const auto before = foo.hash();
+  foo[limit / 3] = -1;
+  assert (foo != bar);
+  assert (foo < bar);
+  assert (bar > foo);
+  assert (foo.hash() != before);
+  foo[limit / 3] = limit / 3;
+  assert (foo.hash() == before);
+  foo.segment(1)[0] = -1;
+  assert (foo.hash() != before);
+  foo.segment(1)[0] = static_cast<int>(foo.segment_capacity());
+  assert (foo.hash() == before);
+  bar.pop_back();
+  assert (foo != bar);
+  assert (bar < foo);
+  assert (bar.hash() != before);
+  bar.push_back(limit - 1);
+  assert (bar.hash() == before);
+
+  succinct::vector<string> baz, qux;
+  baz.push_back("a");
+  qux.push_back("a");
+  assert (baz == qux);
+  assert (baz.hash() == qux.hash());
+  qux.push_back("b");
+  assert (baz < qux);
+}
+
+void diff_test() {
+  succinct::vector<unsigned> foo;
+  const unsigned limit = 50000;
+  for(unsigned i = 0; i < limit; ++i) {
+    foo.push_back(i);
+  }
+  succinct::vector<unsigned> replica(foo);
+  // Cache the hashes of both
+  assert (foo.rehash() == foo.hash());
+  assert (replica.rehash() == foo.hash());
+  foo[3] = 0;
+  foo[4] = 0;
+  foo[limit / 2] = 0;
+  auto p = succinct::diff(replica, foo);
+  assert (p.ranges.size() == 2);
+  assert (p.items.size() == 3);
+  succinct::vector<unsigned> copy(replica);
+  succinct::apply_patch(copy, p);
+  assert (copy == foo);
+
+  // Growing, shrinking, and different shapes
+  succinct::vector<unsigned> bar;
+  bar.reserve(4 * limit);
+  for(unsigned i = 0; i < limit + 1000; ++i) {
+    bar.push_back(i % 7 ? i : 0);
+  }
+  p = succinct::diff(foo, bar);
+  copy = foo;
+  succinct::apply_patch(copy, p);
+  assert (copy == bar);
+  p = succinct::diff(bar, foo);
+  copy = bar;
+  succinct::apply_patch(copy, p);
+  assert (copy == foo);
+  assert (succinct::diff(foo, foo).ranges.size() == 0);
+}
+
+void filter_test() {
+  succinct::vector<unsigned> foo;
+  succinct::vector<double> bar;
+  const unsigned limit = 100000;
+  for(unsigned i = 0; i < limit; ++i) {
+    foo.push_back(static_cast<unsigned>(rand()) % 1000);
+    bar.push_back(foo[i]);
+  }
+  const auto odd = succinct::filter(foo, is_odd);
+  const auto odd_indices = succinct::filter_indices(foo, is_odd);
+  const auto small = succinct::filter(bar, [](const double x) { return x < 10; });
+  assert (odd.size() == odd_indices.size());
+  unsigned j = 0, k = 0;
+  for(unsigned i = 0; i < limit; ++i) {
+    if (is_odd(foo[i])) {
+      assert (odd[j] == foo[i]);
+      assert (odd_indices[j] == i);
+      ++j;
+    }
+    if (bar[i] < 10) {
+      assert (small[k] == bar[i]);
+      ++k;
+    }
+  }
+  assert (j == odd.size());
+  assert (k == small.size());
+  assert (succinct::filter(foo, [](unsigned) { return false; }).size() == 0);
+  assert (succinct::filter(foo, [](unsigned) { return true; }) == foo);
+}
+
+void scan_test() {
+  const unsigned limit = 100000;
+  for(unsigned threads = 1; threads <= 4; threads += 3) {
+    succinct::vector<unsigned long> foo, bar;
+    for(unsigned i = 0; i < limit; ++i) {
+      foo.push_back(i % 13);
+    }
+    bar = foo;
+    succinct::inclusive_scan(foo, std::plus<unsigned long>(), threads);
+    succinct::exclusive_scan(bar, 5ul, std::plus<unsigned long>(), threads);
+    unsigned long total = 0;
+    for(unsigned i = 0; i < limit; ++i) {
+      assert (bar[i] == total + 5);
+      total += i % 13;
+      assert (foo[i] == total);
+    }
+  }
+  succinct::vector<int> empty;
+  succinct::inclusive_scan(empty);
+  succinct::exclusive_scan(empty);
+  assert (empty.size() == 0);
+  succinct::vector<int> one;
+  one.push_back(3);
+  succinct::inclusive_scan(one);
+  assert (one[0] == 3);
+  succinct::exclusive_scan(one);
+  assert (one[0] == 0);
+}
+
+void aggregate_test() {
+  const unsigned limit = 100000;
+  for(unsigned threads = 1; threads <= 4; threads += 3) {
+    succinct::vector<double> xs;
+    succinct::vector<unsigned> keys;
+    succinct::vector<long> values;
+    for(unsigned i = 0; i < limit; ++i) {
+      xs.push_back(static_cast<double>(i % 100) / 10.0);
+      keys.push_back(i % 7);
+      values.push_back(static_cast<long>(i));
+    }
+    // Only 0.0 to 4.9 are in range, 50 values per bin
+    const succinct::vector<std::size_t> counts =
+      succinct::histogram(xs, 0.0, 5.0, 10, threads);
+    assert (counts.size() == 10);
+    for(unsigned b = 0; b < 10; ++b) {
+      assert (counts[b] == limit / 100 * 5);
+    }
+    const succinct::vector<long> sums =
+      succinct::group_sum(keys, values, 7, threads);
+    const std::unordered_map<unsigned, long> hashed =
+      succinct::group_sum_hashed(keys, values, threads);
+    assert (hashed.size() == 7);
+    for(unsigned k = 0; k < 7; ++k) {
+      long expected = 0;
+      for(unsigned i = k; i < limit; i += 7) {
+        expected += static_cast<long>(i);
+      }
+      assert (sums[k] == expected);
+      assert (hashed.at(k) == expected);
+    }
+  }
+  // Vectors of different shapes
+  succinct::vector<unsigned> keys;
+  succinct::vector<int> values;
+  values.reserve(1 << 16);
+  for(unsigned i = 0; i < 1000; ++i) {
+    keys.push_back(i % 2);
+    values.push_back(1);
+  }
+  assert (keys.segment_capacity() != values.segment_capacity());
+  const succinct::vector<int> sums = succinct::group_sum(keys, values, 2);
+  assert (sums[0] == 500 and sums[1] == 500);
+  succinct::vector<int> empty;
+  assert (succinct::histogram(empty, 0, 1, 3)[2] == 0);
+}
+
+void erase_test() {
+  succinct::vector<unsigned> foo;
+  for(unsigned i = 0; i < 10; ++i) {
+    foo.push_back(i);
+  }
+  foo.swap_remove(2);
+  assert (foo.size() == 9 and foo[2] == 9 and foo[8] == 8);
+  foo.swap_remove(8);
+  assert (foo.size() == 8 and foo[7] == 7);
+
+  const unsigned limit = 100000;
+  for(unsigned step = 1; step <= 1000; step *= 10) {
+    succinct::vector<unsigned> bar;
+    for(unsigned i = 0; i < limit; ++i) {
+      bar.push_back(i);
+    }
+    const std::uint64_t before = bar.hash();
+    // Keep every step-th item
+    const std::size_t erased = 
+      bar.erase_if([=](const unsigned x) { return 0 != x % step; });
+    assert (erased == limit - limit / step);
+    assert (bar.size() == limit / step);
+    assert ((1 == step) == (bar.hash() == before));
+    for(unsigned i = 0; i < bar.size(); ++i) {
+      assert (bar[i] == i * step);
+    }
+    // The vector is still usable after shrinking
+    bar.push_back(1);
+    bar.pop_back();
+    assert (bar.erase_if([](unsigned) { return true; }) == limit / step);
+    assert (bar.size() == 0);
+    bar.push_back(3);
+    assert (bar[0] == 3);
+  }
+}
+
+// Orders pairs by their first item only, to check stability
+bool first_less(const std::pair<unsigned, unsigned> & x,
+                const std::pair<unsigned, unsigned> & y) {
+  return x.first < y.first;
+}
+
+void merge_test() {
+  typedef std::pair<unsigned, unsigned> item;
+  for(unsigned threads = 1; threads <= 4; threads += 3) {
+    succinct::vector<item> foo, bar;
+    // foo has the even keys twice, bar has every key once
+    for(unsigned i = 0; i < 20000; ++i) {
+      foo.push_back(item(i - i % 2, 0));
+    }
+    for(unsigned i = 0; i < 30000; ++i) {
+      bar.push_back(item(i, 1));
+    }
+    const succinct::vector<item> merged = 
+      succinct::merge(foo, bar, first_less, threads);
+    succinct::vector<item> in_place = foo;
+    succinct::inplace_merge(in_place, bar, first_less);
+    assert (merged.size() == 50000);
+    assert (merged == in_place);
+    // Neither leaves a reservation behind
+    assert (0 == merged.statistics().reserved_capacity);
+    assert (0 == in_place.statistics().reserved_capacity);
+    std::size_t i = 0;
+    for(unsigned key = 0; key < 30000; ++key) {
+      if (key < 20000 and 0 == key % 2) {
+        assert (merged[i++] == item(key, 0));
+        assert (merged[i++] == item(key, 0));
+      }
+      assert (merged[i++] == item(key, 1));
+    }
+    assert (i == merged.size());
+  }
+  succinct::vector<int> empty, one;
+  one.push_back(5);
+  assert (succinct::merge(empty, one) == one);
+  assert (succinct::merge(one, empty) == one);
+  succinct::inplace_merge(empty, one);
+  assert (empty == one);
+  // A reservation the caller made is kept
+  succinct::vector<int> reserved, odd, all;
+  reserved.reserve(3000);
+  for(int i = 0; i < 2000; ++i) {
+    (0 == i % 2 ? reserved : odd).push_back(i);
+    all.push_back(i);
+  }
+  reserved.rehash();
+  const std::size_t reserved_capacity = reserved.capacity();
+  succinct::inplace_merge(reserved, odd);
+  assert (reserved == all);
+  assert (reserved.rehash() == all.hash());
+  assert (reserved.capacity() == reserved_capacity);
+}
+
+void radix_sort_test() {
+  const unsigned limit = 300000;
+  for(unsigned threads = 1; threads <= 4; threads += 3) {
+    succinct::vector<std::uint64_t> foo;
+    succinct::vector<double> bar;
+    succinct::vector<std::int32_t> keys;
+    succinct::vector<unsigned> values;
+    for(unsigned i = 0; i < limit; ++i) {
+      const std::uint64_t r = (static_cast<std::uint64_t>(rand()) << 31) ^ 
+        static_cast<std::uint64_t>(rand());
+      foo.push_back(r);
+      bar.push_back(static_cast<double>(rand() - RAND_MAX / 2) / 7.0);
+      keys.push_back(static_cast<std::int32_t>(rand() % 1000) - 500);
+      values.push_back(i);
+    }
+    bar[0] = -0.0;
+    bar[1] = 0.0;
+    succinct::radix_sort(foo, threads);
+    succinct::radix_sort(bar, threads);
+    succinct::radix_sort(keys, values, threads);
+    for(unsigned i = 1; i < limit; ++i) {
+      assert (foo[i-1] <= foo[i]);
+      assert (bar[i-1] <= bar[i]);
+      assert (keys[i-1] <= keys[i]);
+      // Stable: values with equal keys stay in order
+      assert (keys[i-1] < keys[i] or values[i-1] < values[i]);
+    }
+    assert (keys[0] >= -500 and keys[limit-1] < 500);
+  }
+  succinct::vector<float> baz;
+  baz.push_back(2.5f);
+  baz.push_back(-1.0f);
+  baz.push_back(-3.0f);
+  baz.push_back(0.0f);
+  succinct::radix_sort(baz);
+  assert (baz[0] == -3.0f and baz[1] == -1.0f and baz[2] == 0.0f and baz[3] == 2.5f);
+  succinct::vector<std::uint32_t> empty;
+  succinct::radix_sort(empty);
+}
+
+void iterator_test() {
+  typedef succinct::vector<int>::iterator iterator;
+  typedef succinct::vector<int>::const_iterator const_iterator;
+  static_assert(std::is_convertible<iterator, const_iterator>::value, 
+                "iterators convert to const_iterators");
+  static_assert(not std::is_convertible<const_iterator, iterator>::value, 
+                "const_iterators do not convert to iterators");
+  succinct::vector<int> foo;
+  for(int i = 0; i < 1000; ++i) {
+    foo.push_back((i * 37) % 1000);
+  }
+  std::sort(foo.begin(), foo.end());
+  const succinct::vector<int> & bar = foo;
+  int expected = 0;
+  for(succinct::vector<int>::const_iterator it = bar.begin(); it != bar.end(); ++it) {
+    assert (*it == expected++);
+  }
+  assert (bar.end() - bar.begin() == 1000);
+  assert (bar.begin()[500] == 500);
+  assert (std::lower_bound(bar.begin(), bar.end(), 700) - bar.begin() == 700);
+  succinct::vector<int>::const_iterator it = foo.begin();
+  assert (it == bar.cbegin());
+  long total = 0;
+  succinct::for_each(bar, [&](const int x) { total += x; });
+  assert (total == 999 * 1000 / 2);
+  succinct::for_each(foo, [](int & x) { x *= 2; });
+  assert (foo[999] == 1998);
+#if __cplusplus >= 202002L
+  static_assert(std::ranges::random_access_range<succinct::vector<int> >);
+  static_assert(std::ranges::sized_range<const succinct::vector<int> >);
+  static_assert(std::ranges::random_access_range<
+                  decltype(foo.segments())>);
+  int i = 0;
+  for (const int x : bar.segments() | std::views::join) {
+    assert (x == 2 * i++);
+  }
+  assert (i == 1000);
+  for (const std::span<int> segment : foo.segments()) {
+    for (int & x : segment) {
+      x = 0;
+    }
+  }
+  assert (std::ranges::count(foo, 0) == 1000);
+#endif
+}
+
+void log_test() {
+  const unsigned limit = 100000;
+  succinct::log_vector<unsigned> foo;
+  succinct::log_vector<unsigned>::subscription early = foo.subscribe();
+  // Readers follow along on other threads, including one that starts
+  // partway through.
+  unsigned totals[2] = {0, 0};
+  std::thread readers[2];
+  for(unsigned r = 0; r < 2; ++r) {
+    readers[r] = std::thread([&foo, &totals, r]() {
+      succinct::log_vector<unsigned>::subscription sub = foo.subscribe(r * 1000);
+      unsigned batch[300];
+      unsigned expected = r * 1000;
+      std::size_t n;
+      while ((n = sub.next(batch, 300)) > 0) {
+        for(std::size_t j = 0; j < n; ++j) {
+          assert (batch[j] == expected++);
+        }
+        totals[r] += static_cast<unsigned>(n);
+      }
+    });
+  }
+  for(unsigned i = 0; i < limit; ++i) {
+    foo.push_back(i);
+    if (0 == i % 10000) {
+      foo.flush();
+    }
+  }
+  unsigned batch[8];
+  assert (early.try_next(batch, 8) == 8 and batch[7] == 7);
+  foo.close();
+  readers[0].join();
+  readers[1].join();
+  assert (totals[0] == limit and totals[1] == limit - 1000);
+  assert (foo.published() == limit);
+#if __cplusplus >= 202002L
+  unsigned expected = 8;
+  for (const std::span<const unsigned> items : early.batches(1000)) {
+    for (const unsigned x : items) {
+      assert (x == expected++);
+    }
+  }
+  assert (expected == limit);
+#endif
+}
+
+void channel_test() {
+  const unsigned limit = 200000;
+  succinct::spsc_channel<unsigned> foo;
+  std::thread producer([&foo]() {
+    unsigned batch[100];
+    for(unsigned i = 0; i < limit; ) {
+      if (0 == (i / 1000) % 2) {
+        foo.push(i++);
+      } else {
+        for(unsigned j = 0; j < 100; ++j) {
+          batch[j] = i++;
+        }
+        foo.push(batch, batch + 100);
+      }
+    }
+    foo.close();
+  });
+  unsigned expected = 0;
+  unsigned batch[500];
+  while (not foo.drained()) {
+    const std::size_t n = foo.try_pop(batch, 500);
+    for(std::size_t j = 0; j < n; ++j) {
+      assert (batch[j] == expected++);
+    }
+    if (0 == n) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+  assert (expected == limit);
+  unsigned x;
+  assert (not foo.try_pop(x));
+  succinct::spsc_channel<std::string> bar;
+  bar.push("a");
+  std::string y;
+  assert (not bar.try_pop(y));
+  bar.flush();
+  assert (bar.try_pop(y) and y == "a");
+  assert (not bar.drained());
+  bar.close();
+  assert (bar.drained());
+}
+
+void mpmc_test() {
+  succinct::mpmc_queue<int> foo(4);
+  int x;
+  assert (not foo.try_pop(x));
+  for(int i = 0; i < 100000; ++i) {
+    foo.push(i);
+  }
+  // Segments grow to about \sqrt{n} items
+  assert (foo.allocated_slots() >= 100000);
+  assert (foo.allocated_slots() < 100000 + 8 * 317);
+  assert (foo.allocated_segments() < 2 * 317);
+  for(int i = 0; i < 99000; ++i) {
+    assert (foo.try_pop(x) and x == i);
+  }
+  // Drained segments are freed while the queue is in use, and new
+  // ones are sized for its current length.
+  for(int i = 100000; i < 300000; ++i) {
+    foo.push(i);
+    assert (foo.try_pop(x) and x == i - 1000);
+  }
+  assert (foo.allocated_slots() < 2 * 1000);
+  for(int i = 299000; i < 300000; ++i) {
+    assert (foo.try_pop(x) and x == i);
+  }
+  assert (not foo.try_pop(x));
+  foo.push(7);
+  assert (foo.try_pop(x) and x == 7 and not foo.try_pop(x));
+
+  // Producers push (producer, sequence number) pairs; each consumer
+  // must see each producer's items in order.
+  const unsigned per_producer = 50000;
+  typedef std::pair<unsigned, unsigned> item;
+  succinct::mpmc_queue<item> bar(2);
+  std::atomic<unsigned> popped(0);
+  std::thread threads[4];
+  for(unsigned p = 0; p < 2; ++p) {
+    threads[p] = std::thread([&bar, p]() {
+      for(unsigned i = 0; i < per_producer; ++i) {
+        bar.push(item(p, i));
+        if (0 == i % 64) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for(unsigned c = 2; c < 4; ++c) {
+    threads[c] = std::thread([&bar, &popped]() {
+      unsigned next[2] = {0, 0};
+      item y;
+      while (popped.load() < 2 * per_producer) {
+        if (bar.try_pop(y)) {
+          assert (y.second >= next[y.first]);
+          next[y.first] = y.second + 1;
+          ++popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for(unsigned t = 0; t < 4; ++t) {
+    threads[t].join();
+  }
+  assert (popped.load() == 2 * per_producer);
+  item y;
+  assert (not bar.try_pop(y));
+  assert (bar.allocated_slots() < 2 * per_producer);
+}
+
+void io_test() {
+  const char * const path = "/tmp/succinct_io_test";
+  for(unsigned mode = 0; mode < 3; ++mode) {
+    succinct::io_options options;
+    options.use_io_uring = (0 == mode);
+    options.direct = (2 == mode);
+    options.threads = 3;
+    options.queue_depth = 4;
+    succinct::vector<std::uint64_t> foo;
+    for(unsigned i = 0; i < 1000003; ++i) {
+      foo.push_back(i * 7919ull);
+    }
+    succinct::save(foo, path, options);
+    succinct::vector<std::uint64_t> bar;
+    bar.push_back(5);
+    succinct::load(bar, path, options);
+    assert (bar == foo);
+    assert (0 == bar.statistics().reserved_capacity);
+    assert (bar.capacity() == foo.capacity());
+    // A different size means a different shape.
+    succinct::vector<std::uint64_t> small;
+    small.push_back(1);
+    small.push_back(2);
+    succinct::save(small, path, options);
+    succinct::load(bar, path, options);
+    assert (bar == small);
+    succinct::vector<std::uint64_t> empty;
+    succinct::save(empty, path, options);
+    succinct::load(bar, path, options);
+    assert (bar.size() == 0);
+  }
+  succinct::vector<std::uint32_t> wrong;
+  bool threw = false;
+  try {
+    succinct::load(wrong, path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert (threw);
+  std::remove(path);
+}
+
+void checksum_test() {
+  assert (succinct::crc32c(0, "123456789", 9) == 0xe3069283u);
+  assert (succinct::crc32c(succinct::crc32c(0, "1234", 4), "56789", 5) == 0xe3069283u);
+  assert (succinct::crc32c_portable(~0u, 
+            reinterpret_cast<const unsigned char *>("123456789"), 9) 
+          == ~0xe3069283u);
+
+  const char * const path = "/tmp/succinct_checksum_test";
+  succinct::vector<std::uint32_t> foo;
+  for(unsigned i = 0; i < 100000; ++i) {
+    foo.push_back(i);
+  }
+  succinct::save(foo, path);
+  {
+    succinct::mapped_vector<std::uint32_t> bar(path);
+    assert (bar.size() == foo.size());
+    assert (bar.block_count() == (foo.size() + foo.segment_capacity() - 1) 
+                                 / foo.segment_capacity());
+    assert (bar.verified_blocks() == 0);
+    assert (bar[70000] == 70000);
+    assert (bar.verified_blocks() == 1);
+    bar.start_scrub();
+    bar.finish_scrub();
+    assert (bar.verified_blocks() == bar.block_count());
+    for(unsigned i = 0; i < foo.size(); i += 997) {
+      assert (bar[i] == i);
+    }
+  }
+  // Corrupt item 500
+  FILE * const f = std::fopen(path, "r+b");
+  std::fseek(f, static_cast<long>(succinct::io_alignment + 500 * sizeof(std::uint32_t)), SEEK_SET);
+  std::fputc(0xff, f);
+  std::fclose(f);
+  bool threw = false;
+  succinct::vector<std::uint32_t> baz;
+  try {
+    succinct::load(baz, path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert (threw);
+  succinct::io_options unchecked;
+  unchecked.verify = false;
+  succinct::load(baz, path, unchecked);
+  assert (baz[500] != 500 and baz[501] == 501);
+  {
+    succinct::mapped_vector<std::uint32_t> bar(path);
+    assert (bar[99999] == 99999);
+    threw = false;
+    try {
+      bar[500];
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    assert (threw);
+    bar.start_scrub();
+    threw = false;
+    try {
+      bar.finish_scrub();
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    assert (threw);
+  }
+  std::remove(path);
+}
+
+void parse_test() {
+  const std::string text = "1,-2, 3\n\n  40\t-9223372036854775808,9223372036854775807\r\n";
+  succinct::vector<std::int64_t> foo;
+  assert (succinct::append_parsed(foo, text.data(), text.data() + text.size()) == 6);
+  assert (foo.size() == 6);
+  assert (foo[1] == -2 and foo[3] == 40);
+  assert (foo[4] == std::numeric_limits<std::int64_t>::min());
+  assert (foo[5] == std::numeric_limits<std::int64_t>::max());
+  // Leading zeros do not count toward the digits that fit
+  const std::string padded = "000000000000000000001,+0000000000000000000000,"
+    "00000000000000000000000018446744073709551615";
+  succinct::vector<std::uint64_t> padded_values;
+  assert (succinct::append_parsed(padded_values, padded.data(),
+                                  padded.data() + padded.size()) == 3);
+  assert (padded_values[0] == 1 and padded_values[1] == 0);
+  assert (padded_values[2] == std::numeric_limits<std::uint64_t>::max());
+  const std::string floats = "0.1|-2.5e-3|1e300|3.141592653589793238462643|inf|7|.5";
+  succinct::vector<double> bar;
+  assert (succinct::append_parsed(bar, floats.data(), floats.data() + floats.size(), '|') == 7);
+  assert (bar[0] == 0.1 and bar[1] == -2.5e-3 and bar[2] == 1e300);
+  assert (bar[3] == 3.141592653589793 and std::isinf(bar[4]));
+  assert (bar[5] == 7 and bar[6] == 0.5);
+  // Past Clinger's fast path, results match strtod and strtof bit for
+  // bit, including ties, subnormals, and overflow.
+  std::string hard = "9007199254740993,2.2250738585072011e-308,4.9e-324,"
+    "2.4703282292062328e-324,2.4703282292062327e-324,1.7976931348623157e308,"
+    "1.7976931348623159e308,0.000000000000000000000000000000123456789,"
+    "-1234567890123456789e-300,1e-400,3.4028235e38,1.4e-45,7.006492e-46,"
+    "123456789012345678901234567890,0.1e1000,-.0000000";
+  for (unsigned i = 0; i < 20000; ++i) {
+    const std::uint64_t digits = ((static_cast<std::uint64_t>(rand()) << 31)
+      ^ static_cast<std::uint64_t>(rand())) % 10000000000000000000ull;
+    hard += "," + std::to_string(digits >> (rand() % 64)) + "e"
+      + std::to_string(rand() % 700 - 360);
+  }
+  succinct::vector<double> doubles;
+  succinct::vector<float> singles;
+  succinct::append_parsed(doubles, hard.data(), hard.data() + hard.size());
+  succinct::append_parsed(singles, hard.data(), hard.data() + hard.size());
+  const char * token = hard.c_str();
+  for (std::size_t k = 0; k < doubles.size(); ++k) {
+    char * end;
+    const double d = std::strtod(token, &end);
+    const float f = std::strtof(token, 0);
+    assert (0 == std::memcmp(&d, &doubles[k], sizeof(d)));
+    assert (0 == std::memcmp(&f, &singles[k], sizeof(f)));
+    token = end + 1;
+  }
+  assert (doubles.size() == 20016 and singles.size() == 20016);
+  const char * const bad[] = {"1,x", "1,2a", "300", "-1", "1e", "-"};
+  for (unsigned i = 0; i < sizeof(bad) / sizeof(bad[0]); ++i) {
+    bool threw = false;
+    succinct::vector<std::uint8_t> baz;
+    try {
+      succinct::append_parsed(baz, bad[i], bad[i] + std::strlen(bad[i]));
+    } catch (const std::runtime_error &) {
+      threw = true;
+    }
+    assert (threw);
+  }
+  // Enough text to split among threads, parsed from a file
+  std::string big;
+  for (unsigned i = 0; i < 1000000; ++i) {
+    big += std::to_string(i * 37u) + ((i % 10) ? "," : "\n");
+  }
+  const char * const path = "/tmp/succinct_parse_test";
+  FILE * const f = std::fopen(path, "wb");
+  std::fwrite(big.data(), 1, big.size(), f);
+  std::fclose(f);
+  const int fd = ::open(path, O_RDONLY);
+  succinct::vector<std::uint32_t> qux;
+  qux.push_back(5);
+  assert (succinct::append_parsed(qux, fd, ',', 4) == 1000000);
+  ::close(fd);
+  assert (qux.size() == 1000001 and qux[0] == 5);
+  for (unsigned i = 0; i < 1000000; ++i) {
+    assert (qux[i + 1] == i * 37u);
+  }
+  std::remove(path);
+}
+
+void arrow_test() {
+  succinct::vector<std::uint32_t> foo, bar;
+  for(unsigned i = 0; i < 100000; ++i) {
+    foo.push_back(i * 3);
+  }
+  bar.push_back(7);
+  foo.swap(bar);
+  assert (foo.size() == 1 and foo[0] == 7 and bar.size() == 100000);
+  const std::size_t chunks = bar.segment_count();
+  const std::uint32_t * const first = bar.segment(0);
+  ArrowSchema schema;
+  ArrowArray * const arrays = new ArrowArray[chunks];
+  const std::size_t count = succinct::export_arrow_chunks(bar, &schema, arrays);
+  assert (bar.size() == 0);
+  assert (0 == std::strcmp(schema.format, "I"));
+  // The first chunk is the first buffer, not a copy of it
+  assert (arrays[0].buffers[1] == first);
+  std::size_t total = 0;
+  for (std::size_t j = 0; j < count; ++j) {
+    assert (0 == arrays[j].null_count and 0 == arrays[j].buffers[0]);
+    total += static_cast<std::size_t>(arrays[j].length);
+  }
+  assert (total == 100000);
+  // Release the even chunks first; the odd ones must still be alive.
+  for (std::size_t j = 0; j < count; j += 2) {
+    arrays[j].release(&arrays[j]);
+    assert (0 == arrays[j].release);
+  }
+  succinct::vector<std::uint32_t> baz;
+  for (std::size_t j = 1; j < count; j += 2) {
+    const std::size_t before = baz.size();
+    succinct::import_arrow(baz, &arrays[j], &schema);
+    assert (0 == arrays[j].release);
+    assert (baz[before] == static_cast<std::uint32_t>(
+              (j * static_cast<std::size_t>(arrays[0].length)) * 3));
+  }
+  schema.release(&schema);
+  bool threw = false;
+  ArrowSchema wrong;
+  const std::size_t wrong_count = succinct::export_arrow_chunks(foo, &wrong, arrays);
+  assert (1 == wrong_count);
+  try {
+    succinct::vector<double> xyzzy;
+    succinct::import_arrow(xyzzy, &arrays[0], &wrong);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert (threw and 0 == arrays[0].release);
+  wrong.release(&wrong);
+  delete[] arrays;
+}
+
+void npy_test() {
+  const char * const path = "/tmp/succinct_npy_test.npy";
+  succinct::vector<double> foo;
+  for(unsigned i = 0; i < 100000; ++i) {
+    foo.push_back(i * 0.5);
+  }
+  succinct::save_npy(foo, path);
+  FILE * f = std::fopen(path, "rb");
+  char header[128];
+  assert (std::fread(header, 1, sizeof(header), f) == sizeof(header));
+  std::fseek(f, 0, SEEK_END);
+  const long file_size = std::ftell(f);
+  std::fclose(f);
+  assert (0 == std::memcmp(header, "\x93NUMPY\x01\x00", 8));
+  const std::size_t length = static_cast<unsigned char>(header[8])
+    | (static_cast<std::size_t>(static_cast<unsigned char>(header[9])) << 8);
+  assert (0 == (10 + length) % 64 and '\n' == header[10 + length - 1]);
+  const std::string dict(header + 10, length);
+  assert (std::string::npos != dict.find("'descr': '<f8'"));
+  assert (std::string::npos != dict.find("'shape': (100000,)"));
+  assert (static_cast<std::size_t>(file_size) == 10 + length + 100000 * sizeof(double));
+  succinct::vector<double> bar;
+  bar.push_back(1);
+  succinct::load_npy(bar, path);
+  assert (bar == foo);
+  assert (0 == bar.statistics().reserved_capacity);
+  bool threw = false;
+  succinct::vector<float> baz;
+  try {
+    succinct::load_npy(baz, path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert (threw);
+  // A two-dimensional array written by hand
+  std::string dict2 = "{'descr': '<i4', 'fortran_order': False, 'shape': (2, 3), }";
+  dict2.append(128 - 10 - dict2.size() - 1, ' ');
+  dict2 += '\n';
+  f = std::fopen(path, "wb");
+  std::fwrite("\x93NUMPY\x01\x00", 1, 8, f);
+  std::fputc(static_cast<int>(dict2.size()), f);
+  std::fputc(0, f);
+  std::fwrite(dict2.data(), 1, dict2.size(), f);
+  const std::int32_t items[] = {1, 2, 3, 4, 5, 6};
+  std::fwrite(items, sizeof(items[0]), 6, f);
+  std::fclose(f);
+  succinct::vector<std::int32_t> qux;
+  succinct::load_npy(qux, path);
+  assert (qux.size() == 6 and qux[0] == 1 and qux[5] == 6);
+  // A truncated file
+  assert (0 == ::truncate(path, static_cast<off_t>(128 + 5 * sizeof(items[0]))));
+  threw = false;
+  try {
+    succinct::load_npy(qux, path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  // qux was replaced before the end of the file was found.
+  assert (threw and qux.size() == 6 and qux[4] == 5);
+  std::remove(path);
+}
+
+void trace_test() {
+  const char * const path = "/tmp/succinct_trace_test";
+  {
+    succinct::traced_vector<unsigned> foo(path);
+    const succinct::traced_vector<unsigned> & bar = foo;
+    foo.reserve(100);
+    for(unsigned i = 0; i < 1000; ++i) {
+      foo.push_back(i);
+    }
+    foo[300] = bar[200] + 1;
+    const unsigned items[] = {1, 2, 3};
+    foo.append(items, items + 3);
+    foo.pop_back();
+    foo.resize(500);
+    foo.shrink_to_fit();
+    assert (foo.size() == 500 and foo.items()[300] == 201);
+  }
+  const succinct::vector<succinct::trace_record> trace = succinct::load_trace(path);
+  assert (trace.size() == 1007);
+  assert (trace[0].op == succinct::trace_reserve and trace[0].argument == 100);
+  assert (trace[1].op == succinct::trace_push_back);
+  assert (trace[1001].op == succinct::trace_read and trace[1001].argument == 200);
+  assert (trace[1002].op == succinct::trace_write and trace[1002].argument == 300);
+  assert (trace[1003].op == succinct::trace_append and trace[1003].argument == 3);
+  assert (trace[1004].op == succinct::trace_pop_back);
+  assert (trace[1005].op == succinct::trace_resize and trace[1005].argument == 500);
+  assert (trace[1006].op == succinct::trace_shrink_to_fit);
+  succinct::vector<unsigned> baz;
+  const succinct::replay_result a = succinct::replay(trace, baz);
+  std::vector<unsigned> qux;
+  const succinct::replay_result b = succinct::replay(trace, qux);
+  assert (baz.size() == 500 and qux.size() == 500);
+  assert (a.checksum == b.checksum);
+  assert (a.capacity_changes > 0 and b.capacity_changes > 0);
+  // A varint cut short
+  FILE * const f = std::fopen(path, "ab");
+  std::fputc(succinct::trace_read, f);
+  std::fputc(0x80, f);
+  std::fclose(f);
+  bool threw = false;
+  try {
+    succinct::load_trace(path);
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert (threw);
+  std::remove(path);
+}
+
+void adaptive_test() {
+  succinct::vector<unsigned> plain;
+  succinct::adaptive_vector<unsigned> foo;
+  std::size_t plain_rebuilds = 0;
+  // Swing between 2000 and 200000 items
+  for(unsigned round = 0; round < 10; ++round) {
+    for(unsigned i = static_cast<unsigned>(foo.size()); i < 200000; ++i) {
+      const std::size_t capacity = plain.capacity();
+      plain.push_back(i);
+      plain_rebuilds += (plain.capacity() != capacity);
+      foo.push_back(i);
+    }
+    while (foo.size() > 2000) {
+      const std::size_t capacity = plain.capacity();
+      plain.pop_back();
+      plain_rebuilds += (plain.capacity() != capacity);
+      foo.pop_back();
+    }
+  }
+  const succinct::adaptive_statistics stats = foo.statistics();
+  assert (stats.pushes == 200000 + 9 * 198000 and stats.pops == 10 * 198000);
+  assert (stats.rebuilds * 4 < plain_rebuilds);
+  assert (stats.avoided_rebuilds > 0 and stats.holding);
+  assert (stats.overhead_bytes <= stats.overhead_limit);
+  assert (stats.shape.size == 2000 and stats.shape.allocated_bytes > 2000 * sizeof(unsigned));
+  for(unsigned i = 0; i < 2000; ++i) {
+    assert (foo[i] == i);
+  }
+  // Shrinking far exceeds the space ceiling, so the held shape is
+  // released, and the next growth goes straight back to it.
+  foo.resize(10);
+  assert (foo.size() == 10 and foo[9] == 9);
+  succinct::adaptive_statistics small = foo.statistics();
+  assert (small.overhead_bytes <= small.overhead_limit);
+  assert (foo.capacity() < stats.shape.capacity);
+  assert (small.grow_ahead_capacity == stats.shape.capacity);
+  foo.resize(200000);
+  small = foo.statistics();
+  assert (small.grown_ahead == 1 and foo.capacity() == stats.shape.capacity);
+  const succinct::vector_statistics shape = foo.items().statistics();
+  assert (shape.allocated_buffers <= shape.directory_capacity + 1);
+  assert (shape.size == 200000 and shape.reserved_capacity >= shape.size);
+}
+
 int main() {
   const auto seed = static_cast<unsigned int>(time(0));
   cerr << "seed: " << seed << endl;
   srand(seed);
 
   qux();
+  reserve_test();
+  sparse_test();
+  dict_test();
+  delta_test();
+  cold_test();
+  spill_test();
+  compare_test();
+  diff_test();
+  filter_test();
+  scan_test();
+  aggregate_test();
+  erase_test();
+  merge_test();
+  radix_sort_test();
+  iterator_test();
+  log_test();
+  channel_test();
+  mpmc_test();
+  io_test();
+  checksum_test();
+  parse_test();
+  arrow_test();
+  npy_test();
+  trace_test();
+  adaptive_test();
 }